@@ -113,7 +113,7 @@ void AppDelegate::applicationDidFinishLaunching( NS::Notification* pNotification
     
     setMenuActionHandlers(
         [this] {  },
-        [this, resourcePath] { this->getBrainEngine()->save_model("model.bnn"); },
+        [this, resourcePath] { this->getBrainEngine()->checkpoint("model.bnn"); },
         [this, resourcePath] { this->getBrainEngine()->load_model("model.bnn"); }
     );
 
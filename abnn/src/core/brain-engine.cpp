@@ -3,56 +3,105 @@
 
 #include "brain-engine.h"
 #include "brain.h"                 //  <-- needed for SynapsePacked & members
-#include <random>                  //  <-- std::mt19937, distributions
 #include <filesystem>
 #include <fstream>
+#if defined(__APPLE__)
 #include <mach-o/dyld.h>
+#endif
+#include <fcntl.h>
 #include <limits.h>
 #include <numeric>
+#include <unistd.h>
 #include <chrono>
 #include <thread>
 #include <iostream>
+#include "graph-builder.h"
 #include "logger.h"
 #include "stimulus-provider.h"
+#if ABNN_METAL
 #include "common.h"
+#endif
 
 
 namespace fs = std::filesystem;
 
+/* at 0 the simulator would never run a pass or never hand one on */
+static_assert(PASS_BATCH >= 1 && PIPE_DEPTH >= 1 && PIPE_REWARD_LAG >= 1,
+              "PASS_BATCH, PIPE_DEPTH and PIPE_REWARD_LAG must be at least 1");
+
 int step = 0;
 
 /* helpers for paths ---------------------------------------------------- */
 static fs::path data_path(const std::string& f){ return fs::current_path()/f; }
+#if defined(__APPLE__)
 static fs::path bundle_resource(const std::string& f){
     char exe[PATH_MAX]; uint32_t n=sizeof(exe); _NSGetExecutablePath(exe,&n);
     return fs::canonical(exe).parent_path().parent_path()/ "Resources"/f;}
-
-/* random graph --------------------------------------------------------- */
-static void build_random_graph(Brain& b)
+#else
+static fs::path bundle_resource(const std::string& f){
+    return fs::read_symlink("/proc/self/exe").parent_path()/f;}
+#endif
+
+/* delta checkpoint k of model file p: p.d1, p.d2, … ------------------- */
+static fs::path delta_path(const fs::path& p, uint32_t k){
+    fs::path d=p; d+=".d"+std::to_string(k); return d;}
+static void remove_deltas(const fs::path& p, uint32_t from){
+    std::error_code ec;
+    for(uint32_t k=from; fs::exists(delta_path(p,k)); ++k) fs::remove(delta_path(p,k),ec);}
+
+/* flush a file or directory to the device */
+static bool sync_path(const fs::path& p){
+    int fd=::open(p.c_str(),O_RDONLY); if(fd<0) return false;
+#if defined(F_FULLFSYNC)
+    bool ok=::fcntl(fd,F_FULLFSYNC)==0;     /* fsync leaves it in the drive cache */
+#else
+    bool ok=::fsync(fd)==0;
+#endif
+    ::close(fd); return ok;}
+
+/* write via f into p.tmp, then rename over p; the data is on disk
+   before the name points at it, so a crash leaves the old or the new
+   file, never a torn one                                               */
+template<class F>
+static bool write_replace(const fs::path& p, F&& f){
+    fs::path tmp=p; tmp+=".tmp";
+    { std::ofstream os(tmp,std::ios::binary); if(!os) return false;
+      f(os); os.flush(); if(!os) return false; }
+    if(!sync_path(tmp)) return false;
+    std::error_code ec; fs::rename(tmp,p,ec); if(ec) return false;
+    sync_path(p.parent_path()); return true;}
+
+/* pipeline items ------------------------------------------------------- */
+struct BrainEngine::StimItem
 {
-    std::mt19937 gen(1);
-    std::uniform_real_distribution<float> wIn(0.4f,0.8f),
-                                          wHH(0.1f,0.2f);
-
-    auto* syn = reinterpret_cast<SynapsePacked*>(b.synapse_buffer()->contents());
-    uint32_t idx=0,max=b.n_syn();
-
-    /* dense input→output */
-    for(uint32_t i=0;i<b.n_input() && idx<max;++i)
-        for(uint32_t o=0;o<b.n_output() && idx<max;++o)
-            syn[idx++] = { i, b.n_input()+o, wIn(gen), 0.f };
+    PassFrame          frame;
+    std::vector<float> expected;
+};
 
-    /* sparse hidden */
-    std::uniform_int_distribution<uint32_t> hid(
-        b.n_input()+b.n_output(), b.n_neuron()-1);
-
-    while(idx<max)
-        syn[idx++] = { hid(gen), hid(gen), wHH(gen), 0.f };
-
-    b.synapse_buffer()->didModifyRange(NS::Range(0,max*sizeof(SynapsePacked)));
-}
+struct BrainEngine::ReadoutItem
+{
+    uint32_t                        k{0};
+    std::vector<PassFrame>          frames;
+    std::vector<std::vector<float>> expected;
+    std::vector<uint8_t>            spikes;     /* k × nOut              */
+    TraversalStats                  stats;      /* k passes, CPU backend */
+    PipelineStats                   pipe;       /* simulator-thread time */
+};
+
+/* background checkpoint being written ---------------------------------- */
+struct BrainEngine::CkptJob
+{
+    fs::path          model, file;              /* chain base, file written */
+    bool              delta{false};
+    double            stallMs{0};               /* simulator paused        */
+    std::chrono::steady_clock::time_point t0;
+    uint64_t          id{0};                    /* 0 → write failed        */
+    std::atomic<bool> done{false};
+    std::thread       writer;
+};
 
 /* ctor / dtor ---------------------------------------------------------- */
+#if ABNN_METAL
 BrainEngine::BrainEngine(MTL::Device* dev,
                          uint32_t nIn, uint32_t nOut,
                          uint32_t events)
@@ -67,19 +116,61 @@ BrainEngine::BrainEngine(MTL::Device* dev,
     brain_->build_pipeline(device_, defaultLib_);
     brain_->build_buffers (device_);
 
+    init_model();
+}
+#endif
+
+BrainEngine::BrainEngine(uint32_t nIn, uint32_t nOut,
+                         uint32_t events, uint32_t nThreads)
+: nIn_(nIn), nOut_(nOut), eventsPerPass_(events),
+  spikeWindow_(nOut,0)
+{
+    brain_ = std::make_unique<Brain>(nIn_, nOut_, NUM_HIDDEN, NUM_SYN, eventsPerPass_,
+                                     HIDDEN_RESERVE, SYN_RESERVE);
+    brain_->build_host_buffers(nThreads, SynapseLayout(CPU_SYNAPSE_LAYOUT),
+                               WeightFormat(CPU_WEIGHT_FORMAT), HostPages(CPU_HUGE_PAGES));
+    brain_->set_active_set(CPU_ACTIVE_SET);
+    brain_->set_deterministic(CPU_DETERMINISTIC);
+    brain_->set_spike_bitmap(CPU_SPIKE_BITMAP);
+    brain_->set_numa(CPU_NUMA);
+
+    init_model();
+}
+
+void BrainEngine::init_model()
+{
     logger_ = std::make_unique<Logger>(nIn_, nOut_);
 
     if(!load_model()) {
-        std::cout<<"🆕  building random graph…\n";
-        build_random_graph(*brain_); save_model();
+        /* reproducible for a fixed RNG_SEED, so saving it is optional */
+        const Topology topo = Topology(GRAPH_TOPOLOGY);
+        std::cout<<"🆕  building "<<topology_name(topo)<<" graph…\n";
+        const auto t0 = std::chrono::steady_clock::now();
+        if(INH_FRACTION > 0 && brain_->cpu_backend()){
+            brain_->set_inhibitory(float(INH_FRACTION));
+            std::cout<<"⚖️  "<<brain_->n_inhibitory()<<" of "<<brain_->n_hidden()<<" hidden neurons inhibitory\n";
+        }
+        build_graph(brain_->synapses(), { nIn_, nOut_, brain_->n_neuron(), brain_->n_inhibitory() },
+                    topo, { GRAPH_WS_BETA, GRAPH_SIGMA }, brain_->key(), brain_->worker_pool());
+        brain_->synapses_modified();
+        const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+        std::cout<<"🆕  "<<brain_->n_syn()<<" synapses in "<<sec<<" s ("
+                 <<brain_->synapses().bytes()*1e-9/sec<<" GB/s)\n";
+        brain_->reorder_neurons(NeuronOrder(NEURON_ORDER));
+        if(GRAPH_SAVE) save_model();
+    } else if(NEURON_ORDER && !sorted_by_src_dst(brain_->synapses())) {
+        reorder_model(NEURON_ORDER);
     }
 }
 
 BrainEngine::~BrainEngine(){
     stop_async();
+#if ABNN_METAL
     if(commandQueue_)commandQueue_->release();
     if(defaultLib_)  defaultLib_->release();
-    if(device_)      device_->release(); }
+    if(device_)      device_->release();
+#endif
+}
 
 /* model I/O ------------------------------------------------------------ */
 bool BrainEngine::load_model(const std::string& nm){
@@ -88,66 +179,321 @@ bool BrainEngine::load_model(const std::string& nm){
         fs::path ro=bundle_resource("model.bnn");
         fs::path f = fs::exists(rw)? rw: ro;
         if(!fs::exists(f)) return false;
-        std::ifstream is(f,std::ios::binary);
-        if(!is) return false;
-        brain_->load(is); std::cout<<"✅ loaded \""<<f<<"\"\n"; return true;
+        /* zero-copy: map the payload, pages fault in on first use */
+        if(CPU_MMAP_LOAD && brain_->cpu_backend()
+           && brain_->load_mapped(f.string(), MapMode(CPU_MMAP_LOAD-1))){
+            std::cout<<"✅ mapped \""<<f<<"\" ("
+                     <<(CPU_MMAP_LOAD==2 ? "shared, in-place" : "copy-on-write")<<")\n";
+        } else {
+            std::ifstream is(f,std::ios::binary);
+            if(!is) return false;
+            brain_->load(is); std::cout<<"✅ loaded \""<<f<<"\"\n";
+        }
+        ckptPath_=f; ckptDeltas_=0;
+        return apply_deltas(f);
     } catch (std::exception* e){
         return false;
     }
 }
 
-bool BrainEngine::save_model(const std::string& nm) const{
+/* replay f.d1, f.d2, … while each names the previous file; a broken link
+   ends the chain and the next save overwrites it                        */
+bool BrainEngine::apply_deltas(const fs::path& f){
+    for(uint32_t k=1; fs::exists(delta_path(f,k)); ++k){
+        try {
+            std::ifstream is(delta_path(f,k),std::ios::binary);
+            brain_->apply_delta(is);
+        } catch (std::exception* e){
+            std::cout<<"⚠️  "<<delta_path(f,k)<<" does not continue the chain, ignored\n";
+            break;
+        }
+        ckptDeltas_=k;
+    }
+    if(ckptDeltas_) std::cout<<"✅ applied "<<ckptDeltas_<<" delta checkpoint(s)\n";
+    return true;
+}
+
+/* the next save of p can go on top of its chain: the chain is short
+   and few weight blocks changed                                         */
+bool BrainEngine::delta_due(const fs::path& p) const{
+    return BNN_DELTA_MAX && p==ckptPath_ && ckptDeltas_<BNN_DELTA_MAX
+        && brain_->delta_ok() && brain_->dirty_fraction()<=BNN_DELTA_DIRTY;}
+
+/* delta on top of the last checkpoint of p when due, otherwise a full
+   rewrite                                                               */
+bool BrainEngine::save_model(const std::string& nm){
     fs::path p=data_path(nm.empty()?"model.bnn":nm);
-    std::ofstream os(p,std::ios::binary); if(!os) return false;
-    brain_->save(os); std::cout<<"💾 saved → \""<<p<<"\"\n"; return true;}
+    /* a shared mapping of p already is the file */
+    if(brain_->sync_mapped(p.string())){
+        remove_deltas(p,1); ckptPath_=p; ckptDeltas_=0;
+        std::cout<<"💾 synced → \""<<p<<"\"\n"; return true; }
+
+    const double dirty=brain_->dirty_fraction();
+    if(delta_due(p)){
+        const fs::path d=delta_path(p,ckptDeltas_+1);
+        uint64_t id=0;
+        if(!write_replace(d,[&](std::ostream& os){ id=brain_->save_delta(os); })) return false;
+        brain_->mark_checkpoint(id); ++ckptDeltas_;
+        remove_deltas(p,ckptDeltas_+1);
+        std::cout<<"💾 delta → \""<<d<<"\" ("<<100.0*dirty<<" % of weight blocks)\n";
+        return true;
+    }
+    return compact_model(nm);}
+
+/* full rewrite; the delta chain of p is folded in and removed. A private
+   mapping of p keeps reading the old inode instead of a file truncated
+   under it                                                              */
+bool BrainEngine::compact_model(const std::string& nm){
+    fs::path p=data_path(nm.empty()?"model.bnn":nm);
+    uint64_t id=0;
+    if(!write_replace(p,[&](std::ostream& os){ id=brain_->save(os, BNN_COMPRESS); })) return false;
+    brain_->mark_checkpoint(id);
+    remove_deltas(p,1); ckptPath_=p; ckptDeltas_=0;
+    std::cout<<"💾 saved → \""<<p<<"\"\n"; return true;}
+
+bool BrainEngine::reorder_model(uint32_t order, const std::string& nm){
+    if(!brain_->reorder_neurons(NeuronOrder(order))) return false;
+    std::cout<<"🔀 neurons relabelled ("<<neuron_order_name(NeuronOrder(order))<<")\n";
+    return save_model(nm);}
 
 /* stimulus ------------------------------------------------------------- */
 void BrainEngine::set_stimulus(std::shared_ptr<StimulusProvider> s){ stim_=std::move(s); }
 
-/* single pass ---------------------------------------------------------- */
-std::vector<bool> BrainEngine::run_one_pass()
+/* teacher forcing ------------------------------------------------------ */
+/* Poisson teacher: pTeach = expected[o] * teacherRate, on every other pass */
+void BrainEngine::teacher_probs(const std::vector<float>& expected,
+                                std::vector<float>& pTeach)
 {
-    if(!stim_) return {};
-    
-    NS::AutoreleasePool* pool = NS::AutoreleasePool::alloc()->init();
-    
-    auto in = stim_->nextInput();
-    auto expected = stim_->nextExpected();
-    
-    brain_->inject_inputs(in, INPUT_RATE_HZ);
+    float teacherRate = teachEven_ ? 1.0f : .0f;
+    pTeach.resize(nOut_);
+    for (uint32_t o = 0; o < nOut_; ++o) pTeach[o] = expected[o] * teacherRate;
+    teachEven_ = !teachEven_;
+}
+
+/* stage 1: stimulus producer ------------------------------------------- */
+void BrainEngine::stimulus_loop()
+{
+    while(running_.load()){
+        StimItem it;
+        it.frame.input = stim_->nextInput();
+        it.expected    = stim_->nextExpected();
+        teacher_probs(it.expected, it.frame.teach);
+
+        while(!stimQ_->try_push(std::move(it))){
+            if(!running_.load()) return;
+            std::this_thread::yield();
+        }
+    }
+}
 
-    //–– Poisson teacher forcing: pTeach = in[o] * teacherRate
-    static thread_local std::mt19937_64 rng{std::random_device{}()};
-    std::uniform_real_distribution<float> uni(0.0f,1.0f);
+/* background checkpoint ------------------------------------------------ */
+/* any thread; the simulator picks the request up between two batches  */
+bool BrainEngine::checkpoint(const std::string& nm){
+    if(!running_.load()) return save_model(nm);
+    std::lock_guard<std::mutex> lk(ckptMu_);
+    if(ckptAsk_.load() || ckptJob_) return false;
+    ckptName_=nm; ckptAsk_.store(true, std::memory_order_release);
+    return true;}
+
+/* simulator thread, between passes: finish a written checkpoint, start
+   a requested one. The stall is the snapshot alone (state copy, dirty
+   map scan, freezing the weights); the file is written meanwhile     */
+void BrainEngine::service_checkpoint(bool drain){
+    using clk = std::chrono::steady_clock;
+    if(ckptJob_ && (drain || ckptJob_->done.load(std::memory_order_acquire))){
+        CkptJob& j=*ckptJob_;
+        j.writer.join();
+        brain_->end_snapshot(j.id);
+        if(j.id){
+            ckptPath_=j.model;
+            if(j.delta){ ++ckptDeltas_; remove_deltas(j.model,ckptDeltas_+1); }
+            else       { remove_deltas(j.model,1); ckptDeltas_=0; }
+            std::cout<<"💾 checkpoint → \""<<j.file<<"\" ("<<(j.delta?"delta":"full")
+                     <<", stall "<<j.stallMs<<" ms, written in "
+                     <<std::chrono::duration<double>(clk::now()-j.t0).count()<<" s)\n";
+        } else {
+            std::cout<<"⚠️  checkpoint "<<j.file<<" failed, next save is full\n";
+        }
+        std::lock_guard<std::mutex> lk(ckptMu_);
+        ckptJob_.reset();
+    }
+    if(drain){
+        if(ckptAsk_.exchange(false)) save_model(ckptName_);
+        return;
+    }
+    if(!ckptAsk_.load(std::memory_order_acquire) || ckptJob_) return;
+
+    std::string nm;
+    { std::lock_guard<std::mutex> lk(ckptMu_); nm=ckptName_; ckptAsk_.store(false); }
+    const fs::path p=data_path(nm.empty()?"model.bnn":nm);
+
+    const auto t0=clk::now();
+    const bool delta=delta_due(p);
+    /* Metal, or a shared mapping (the file itself): synchronously */
+    const MappedFile* m=brain_->synapses().mapped();
+    if((m && m->mode()==MapMode::Shared) || !brain_->begin_snapshot(delta)){ save_model(nm); return; }
+
+    auto j=std::make_unique<CkptJob>();
+    j->model=p; j->delta=delta; j->t0=t0;
+    j->file=delta ? delta_path(p,ckptDeltas_+1) : p;
+    j->stallMs=std::chrono::duration<double,std::milli>(clk::now()-t0).count();
+    CkptJob* jp=j.get();
+    j->writer=std::thread([this,jp]{
+        uint64_t id=0;
+        const bool ok=write_replace(jp->file,[&](std::ostream& os){ id=brain_->write_snapshot(os,BNN_COMPRESS); });
+        jp->id=ok ? id : 0;
+        jp->done.store(true, std::memory_order_release);
+    });
+    std::lock_guard<std::mutex> lk(ckptMu_);
+    ckptJob_=std::move(j);
+}
 
-    uint32_t* lf  = (uint32_t*)brain_->last_fired_buffer()->contents();
-    uint32_t  now = *(uint32_t*)brain_->clock_buffer()->contents();
+/* stage 2: simulator --------------------------------------------------- */
+void BrainEngine::simulate_loop()
+{
+    using clk = std::chrono::steady_clock;
+    const uint32_t batch = brain_->cpu_backend() ? uint32_t(PASS_BATCH) : 1;
+
+    uint64_t      pass = 0, seenSeq = 0;
+    bool          rewireDue = false, growDue = false;   /* held over a checkpoint */
+    PipelineStats ps;
+    auto          t = clk::now();
+    auto lap = [&](double& acc){ auto n=clk::now(); acc+=std::chrono::duration<double>(n-t).count(); t=n; };
+
+    while(running_.load()){
+        service_checkpoint();
+
+        /* reward latency: never more than PIPE_REWARD_LAG passes ahead
+           of the readout stage, so its reward lands within that bound  */
+        const uint64_t ahead = pass - readDone_.load(std::memory_order_acquire);
+        if(ahead >= PIPE_REWARD_LAG){ std::this_thread::yield(); lap(ps.waitLag); continue; }
+
+        uint32_t k = uint32_t(std::min<uint64_t>({ batch, PIPE_REWARD_LAG - ahead,
+                                                   stimQ_->size() }));
+        if(!k){ std::this_thread::yield(); lap(ps.waitStim); continue; }
+
+        ReadoutItem r;
+        r.k = k;
+        r.frames.resize(k);
+        r.expected.resize(k);
+        for(uint32_t p=0;p<k;++p){
+            StimItem it;
+            stimQ_->try_pop(it);
+            r.frames[p]   = std::move(it.frame);
+            r.expected[p] = std::move(it.expected);
+        }
+
+        const uint64_t seq = rewardSeq_.load(std::memory_order_acquire);
+        if(seq != seenSeq){ brain_->set_reward(reward_.load()); seenSeq = seq; }
+
+        simulate(r);
+        if(!pass)
+            std::cout<<"⏱  first pass done "
+                     <<std::chrono::duration<double>(clk::now()-born_).count()
+                     <<" s after engine start\n";
+        pass += k;
+
+        /* structural plasticity between batches, every REWIRE_EVERY passes;
+           a step that falls inside a background checkpoint runs on the
+           first batch after it has been written                        */
+        if(rewireDue || (REWIRE_EVERY && brain_->cpu_backend()
+                         && pass/REWIRE_EVERY != (pass-k)/REWIRE_EVERY)){
+            const RewireStats rs = brain_->rewire({ SYN_PRUNE_W, SYN_NEW_P, SYN_INIT_W, SYN_COMPACT_FRAC });
+            if(rs.deferred){
+                if(!rewireDue) std::cout<<"⏸  rewire deferred: checkpoint in flight\n";
+            } else {
+                std::cout<<"🌱 rewire: -"<<rs.pruned<<" +"<<rs.grown<<" → "<<rs.live<<" live in "
+                         <<rs.end<<" slots"<<(rs.compacted ? " (compacted)" : "")<<", "
+                         <<rs.seconds*1e3<<" ms\n";
+            }
+            rewireDue = rs.deferred;
+        }
 
-    static bool even = false;
-    float teacherRate = even ? 1.0f : .0f;
-    for (uint32_t o = 0; o < nOut_; ++o) {
-        float p = expected[o] * teacherRate;
-        if (uni(rng) < p && (now - lf[nIn_ + o] > 1)) {
-            lf[nIn_ + o] = now;    // inject a “teacher” spike
+        /* online growth, every GROW_EVERY passes while the room lasts,
+           held over a checkpoint the same way                          */
+        if(growDue || (GROW_EVERY && brain_->cpu_backend()
+                       && pass/GROW_EVERY != (pass-k)/GROW_EVERY)){
+            const GrowStats gs = brain_->grow_neurons(GROW_NEURONS, GROW_DEGREE, SYN_INIT_W);
+            if(gs.deferred){
+                if(!growDue) std::cout<<"⏸  growth deferred: checkpoint in flight\n";
+            } else if(gs.neurons){
+                std::cout<<"🌿 grew "<<gs.neurons<<" neurons, "<<gs.synapses<<" synapses → "
+                         <<brain_->n_neuron()<<" neurons, "<<gs.seconds*1e3<<" ms pause\n";
+            } else {
+                std::cout<<"⚠️  no room to grow, raise HIDDEN_RESERVE / SYN_RESERVE\n";
+            }
+            growDue = gs.deferred;
         }
+        lap(ps.busy);
+
+        r.pipe = ps;
+        ps     = PipelineStats{};
+        while(!readQ_->try_push(std::move(r))){
+            if(!running_.load()) return;
+            std::this_thread::yield();
+        }
+        lap(ps.waitOut);
+    }
+}
+
+/* k passes on whichever backend is active ----------------------------- */
+void BrainEngine::simulate(ReadoutItem& r)
+{
+    if(brain_->cpu_backend()) {
+        brain_->run_passes(r.k, r.frames, INPUT_RATE_HZ, r.spikes);
+        r.stats = brain_->batch_stats();
+        return;
     }
-    even = !even;
+#if ABNN_METAL
+    r.spikes.resize(uint64_t(r.k)*nOut_);
+    for(uint32_t p=0;p<r.k;++p){
+        NS::AutoreleasePool* pool = NS::AutoreleasePool::alloc()->init();
 
-    auto cb=commandQueue_->commandBuffer();
+        brain_->inject_inputs(r.frames[p].input, INPUT_RATE_HZ);
+        brain_->inject_teacher(r.frames[p].teach);     // “teacher” spikes on the outputs
 
-    brain_->encode_traversal(cb);
-    
-    cb->commit();
-    cb->waitUntilCompleted();
+        auto cb=commandQueue_->commandBuffer();
+        brain_->encode_traversal(cb);
+        cb->commit();
+        cb->waitUntilCompleted();
+
+        brain_->read_outputs(r.spikes.data() + uint64_t(p)*nOut_);
+        pool->release();
+    }
+#endif
+}
+
+/* stage 3: readout / metrics ------------------------------------------- */
+void BrainEngine::readout_loop()
+{
+    ReadoutItem       r;
+    std::vector<bool> out(nOut_);
+
+    while(running_.load()){
+        if(!readQ_->try_pop(r)){ std::this_thread::yield(); continue; }
 
-    auto out = brain_->read_outputs();
+        if(brain_->cpu_backend()) logger_->log_pass_stats(r.stats, r.k);
+        logger_->log_pipeline(r.pipe, r.k);
 
+        for(uint32_t p=0;p<r.k;++p){
+            const uint8_t* s = r.spikes.data() + uint64_t(p)*nOut_;
+            for(uint32_t o=0;o<nOut_;++o) out[o] = s[o];
+            observe(r.frames[p].input, r.expected[p], out);
+            readDone_.fetch_add(1, std::memory_order_release);
+        }
+    }
+}
+
+/* output filtering, sliding-window loss and reward --------------------- */
+void BrainEngine::observe(const std::vector<float>& in,
+                          const std::vector<float>& expected,
+                          const std::vector<bool>&  out)
+{
     static std::vector<float> rate(nOut_, 0.f);
     const float alpha = 0.5f;                // smoothing factor
 
-    auto spikes = brain_->read_outputs();
     for (int i = 0; i < nOut_; ++i) {
-        rate[i] = (1-alpha)*rate[i] + alpha*(spikes[i]?1.f:0.f);
+        rate[i] = (1-alpha)*rate[i] + alpha*(out[i]?1.f:0.f);
     }
 
     auto smoothRate = rateFilter_.process(rate, dT_SEC);
@@ -177,33 +523,33 @@ std::vector<bool> BrainEngine::run_one_pass()
             loss += err * err;
         }
         loss /= nOut_;
-        float* r=(float*)brain_->reward_buffer()->contents();
-        *r = float(lastLoss_ - loss);
-        brain_->reward_buffer()->didModifyRange(NS::Range(0,4));
+        reward_.store(float(lastLoss_ - loss));        /* simulator applies it */
+        rewardSeq_.fetch_add(1, std::memory_order_release);
         lastLoss_=loss;
         logger_->accumulate_loss(loss);
         winPos_=0;
     }
-    
-    pool->release();
-    return out;
 }
 
-/* async loop ----------------------------------------------------------- */
+/* async pipeline ------------------------------------------------------- */
 void BrainEngine::start_async(){
     if(running_.load()||!stim_) return;
+    stimQ_     = std::make_unique<SpscQueue<StimItem>>(PIPE_DEPTH);
+    readQ_     = std::make_unique<SpscQueue<ReadoutItem>>(PIPE_DEPTH);
+    readDone_.store(0);
     running_.store(true);
-    worker_=std::thread([this]{
-        while(running_.load()){
-            run_one_pass();
-        }
-    });
-    std::cout<<"▶️ Engine async loop started\n";
+    stimThread_ = std::thread([this]{ stimulus_loop(); });
+    worker_     = std::thread([this]{ simulate_loop(); });
+    readThread_ = std::thread([this]{ readout_loop();  });
+    std::cout<<"▶️ Engine async pipeline started\n";
 }
 
 void BrainEngine::stop_async(){
     if(!running_.load()) return;
     running_.store(false);
-    if(worker_.joinable()) worker_.join();
-    std::cout<<"⏹️ Engine async loop stopped\n";
+    for(auto* t : { &stimThread_, &worker_, &readThread_ })
+        if(t->joinable()) t->join();
+    /* the simulator is gone: finish a checkpoint in flight here */
+    service_checkpoint(true);
+    std::cout<<"⏹️ Engine async pipeline stopped\n";
 }
@@ -2,23 +2,36 @@
 /* brain-engine.h  –  harness driving a Brain instance
  * =====================================================================
  * Implements
+ *   • three-stage async pipeline: stimulus producer → simulator →
+ *     readout/metrics, joined by bounded SPSC queues; the simulator
+ *     stays within PIPE_REWARD_LAG passes of the readout stage so a
+ *     reward computed from pass N reaches the brain by pass N+LAG
  *   • teacher forcing
  *   • sliding-window loss  (window = 1000 passes ≈ 1 s)
  *   • graded reward  (loss decrease → positive reward)
  *
  * Public API
- *   BrainEngine(device,nInput,nOutput [,eventsPerPass])
+ *   BrainEngine(device,nInput,nOutput [,eventsPerPass])     Metal backend
+ *   BrainEngine(nInput,nOutput [,eventsPerPass,nThreads])   CPU backend
  *   set_stimulus(shared_ptr<StimulusProvider>)
+ *   reorder_model(order)                                    NEURON_ORDER
+ *   save_model() / compact_model()                          BNN_DELTA_MAX
+ *   checkpoint()                     background save while running
  *   start_async() / stop_async()
  */
 
-#include <Metal/Metal.hpp>
+#include "platform.h"
 #include <memory>
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
 #include <cstdint>
+#include <filesystem>
 #include "rate-filter.h"
+#include "spsc-queue.h"
 #include "constants.h"
 
 
@@ -26,6 +39,7 @@
 
 /* forward decls -------------------------------------------------------- */
 class Brain;
+struct PassFrame;
 class Logger;
 class StimulusProvider;
 
@@ -33,53 +47,118 @@ class StimulusProvider;
 class BrainEngine
 {
 public:
+#if ABNN_METAL
     BrainEngine(MTL::Device* device,
                 uint32_t     nInput,
                 uint32_t     nOutput,
                 uint32_t     eventsPerPass = EVENTS_PER_PASS);
+#endif
+    /* CPU backend; nThreads 0 → all cores */
+    BrainEngine(uint32_t     nInput,
+                uint32_t     nOutput,
+                uint32_t     eventsPerPass = EVENTS_PER_PASS,
+                uint32_t     nThreads      = CPU_THREADS);
     ~BrainEngine();
 
     /* attach stimulus generator BEFORE start_async() */
     void set_stimulus(std::shared_ptr<StimulusProvider> stim);
 
-    /* non-blocking background loop */
+    /* non-blocking background pipeline (three threads) */
     void start_async();
     void stop_async();
     
-    /* model persistence (binary .bnn) */
+    /* model persistence (binary .bnn): load_model() also replays the
+       delta checkpoints model.bnn.d1, .d2, …; save_model() appends a
+       delta while the chain is short and sparse, compact_model()
+       always rewrites the full file and drops the chain              */
     bool  load_model(const std::string& filename = "");
-    bool  save_model(const std::string& filename = "") const;
+    bool  save_model(const std::string& filename = "");
+    bool  compact_model(const std::string& filename = "");
+
+    /* save_model() without pausing the pipeline: the simulator takes a
+       copy-on-write snapshot at its next pass boundary and a writer
+       thread saves it while passes go on. Returns at once; false → a
+       checkpoint is still in flight. Pipeline stopped → save_model()   */
+    bool  checkpoint(const std::string& filename = "");
+
+    /* offline pass: relabel neurons for locality and rewrite the .bnn */
+    bool  reorder_model(uint32_t order, const std::string& filename = "");
 
 private:
     float maxObserved = 0.5f;     // initialize to expected plateau
 
-    /* single synchronous simulation pass */
-    std::vector<bool> run_one_pass();
-
+    /* shared ctor tail: load or build the graph */
+    void init_model();
+    bool apply_deltas(const std::filesystem::path& model);
+    bool delta_due(const std::filesystem::path& model) const;
+
+    /* pipeline stages; the simulator runs up to PASS_BATCH queued
+       frames per Brain::run_passes() call (CPU backend)               */
+    struct StimItem;
+    struct ReadoutItem;
+    void stimulus_loop();
+    void simulate_loop();
+    void readout_loop();
+    void simulate(ReadoutItem& r);
+
+    /* background checkpoint: asked by checkpoint(), started and
+       finished by the simulator (or stop_async) between passes       */
+    struct CkptJob;
+    void service_checkpoint(bool drain = false);
+
+    /* per-pass output filtering, loss window and reward (readout) */
+    void observe(const std::vector<float>& in,
+                 const std::vector<float>& expected,
+                 const std::vector<bool>&  out);
+
+    /* alternating Poisson teacher probabilities */
+    void teacher_probs(const std::vector<float>& expected,
+                       std::vector<float>& pTeach);
+
+#if ABNN_METAL
     /* Metal handles ---------------------------------------------------- */
     MTL::Device*       device_{nullptr};
     MTL::CommandQueue* commandQueue_{nullptr};
     MTL::Library*      defaultLib_{nullptr};
+#endif
 
     /* ABNN + logging --------------------------------------------------- */
     std::unique_ptr<Brain>  brain_;
     std::unique_ptr<Logger> logger_;
     std::shared_ptr<StimulusProvider> stim_;
 
-    /* async thread ----------------------------------------------------- */
-    std::thread       worker_;
+    /* async pipeline -------------------------------------------------- */
+    std::thread       stimThread_, worker_, readThread_;
     std::atomic<bool> running_{false};
+    std::unique_ptr<SpscQueue<StimItem>>    stimQ_;
+    std::unique_ptr<SpscQueue<ReadoutItem>> readQ_;
+    std::atomic<uint64_t> readDone_{0};        /* passes observed       */
+    std::atomic<float>    reward_{0.f};        /* readout → simulator   */
+    std::atomic<uint64_t> rewardSeq_{0};
 
     /* dimensions / params --------------------------------------------- */
     uint32_t nIn_{0};
     uint32_t nOut_{0};
     uint32_t eventsPerPass_{0};
 
+    /* checkpoint chain: file the brain was last loaded from / saved to
+       and how many deltas sit on top of it                             */
+    std::filesystem::path ckptPath_;
+    uint32_t              ckptDeltas_{0};
+    std::mutex               ckptMu_;
+    std::atomic<bool>        ckptAsk_{false};
+    std::string              ckptName_;
+    std::unique_ptr<CkptJob> ckptJob_;
+
+    /* construction time, for the time-to-first-pass report */
+    std::chrono::steady_clock::time_point born_{std::chrono::steady_clock::now()};
+
     /* sliding-window loss state --------------------------------------- */
     std::vector<uint32_t> spikeWindow_;   /* counts per output neuron   */
     size_t winPos_{0};
     const size_t WIN_SIZE_ = 1000;        /* 1000 passes ≈ 1 s          */
 
     double lastLoss_{0.25};               /* baseline for graded reward */
+    bool   teachEven_{false};             /* teacher on every other pass */
     RateFilter rateFilter_{ /*τ=*/FILTER_TAU, /*useFIR=*/USE_FIR };
 };
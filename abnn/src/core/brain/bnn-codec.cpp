@@ -0,0 +1,377 @@
+// bnn-codec.cpp  –  lossless block codec for .bnn synapse sections
+// ======================================================================
+
+#include "bnn-codec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "thread-pool.h"
+
+/* ===================================================================== */
+/* block layout: streams back to back, each                              */
+/*   u8 mode, u8 bits, u8 nDict, u8 0, u32 payload bytes, payload         */
+/* BitPack payload starts with the u32 minimum, Dict with its nDict      */
+/* bytes; packed words are little-endian uint32                          */
+enum class StreamMode : uint8_t { Raw = 0, Rle = 1, Dict = 2, DeltaVarint = 3, BitPack = 4 };
+
+static constexpr uint32_t kStreamHead = 8;
+static constexpr uint32_t kMinRun     = 4;     /* shorter runs stay literal */
+
+static inline uint32_t ld32(const uint8_t* p)       { uint32_t v; std::memcpy(&v, p, 4); return v; }
+static inline void     st32(uint8_t* p, uint32_t v) { std::memcpy(p, &v, 4); }
+
+static inline uint32_t varint_bytes(uint32_t v)
+{
+    return 1 + (v>=1u<<7) + (v>=1u<<14) + (v>=1u<<21) + (v>=1u<<28);
+}
+
+static inline uint8_t* put_varint(uint8_t* o, uint64_t v)
+{
+    while(v >= 0x80){ *o++ = uint8_t(v) | 0x80; v >>= 7; }
+    *o++ = uint8_t(v);
+    return o;
+}
+
+/* false → runs past end */
+static inline bool get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& v)
+{
+    v = 0;
+    for(int s=0; s<64 && p<end; s+=7){
+        const uint8_t b = *p++;
+        v |= uint64_t(b & 0x7F) << s;
+        if(!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static inline uint32_t zigzag(uint32_t d)   { return (d<<1) ^ uint32_t(int32_t(d)>>31); }
+static inline uint32_t unzigzag(uint32_t z) { return (z>>1) ^ (0u - (z&1)); }
+
+/* reserve a stream header at the end of out; returns its offset */
+static size_t open_stream(std::vector<uint8_t>& out, StreamMode m, uint8_t bits, uint8_t nDict)
+{
+    const size_t at = out.size();
+    out.resize(at + kStreamHead);
+    out[at] = uint8_t(m); out[at+1] = bits; out[at+2] = nDict; out[at+3] = 0;
+    return at;
+}
+
+static void close_stream(std::vector<uint8_t>& out, size_t at)
+{
+    st32(out.data() + at + 4, uint32_t(out.size() - at - kStreamHead));
+}
+
+/* ===================================================================== */
+/* run-length: varint token, even → (token>>1) literal bytes follow,     */
+/* odd → one byte repeated (token>>1) times                              */
+static void rle_encode(const uint8_t* x, uint32_t n, std::vector<uint8_t>& out)
+{
+    const size_t at = out.size();
+    out.resize(at + n + n/64 + 16);             /* worst case: all literal */
+    uint8_t* o   = out.data() + at;
+    uint32_t lit = 0;                           /* start of pending literal */
+
+    auto flush = [&](uint32_t end){
+        if(end==lit) return;
+        o = put_varint(o, uint64_t(end-lit) << 1);
+        std::memcpy(o, x+lit, end-lit); o += end-lit;
+    };
+
+    uint32_t i = 0;
+    while(i < n){
+        uint32_t r = 1;
+        while(i+r < n && x[i+r]==x[i]) ++r;
+        if(r >= kMinRun){
+            flush(i);
+            o = put_varint(o, uint64_t(r) << 1 | 1);
+            *o++ = x[i];
+            lit = i + r;
+        }
+        i += r;
+    }
+    flush(n);
+    out.resize(o - out.data());
+}
+
+static bool rle_decode(const uint8_t* p, const uint8_t* end, uint8_t* x, uint32_t n)
+{
+    uint32_t i = 0;
+    while(i < n){
+        uint64_t t;
+        if(!get_varint(p, end, t)) return false;
+        const uint64_t len = t >> 1;
+        if(len > n-i) return false;
+        if(t & 1){
+            if(p >= end) return false;
+            std::memset(x+i, *p++, len);
+        } else {
+            if(uint64_t(end-p) < len) return false;
+            std::memcpy(x+i, p, len); p += len;
+        }
+        i += uint32_t(len);
+    }
+    return p==end;
+}
+
+/* ===================================================================== */
+/* one byte plane                                                        */
+static void encode_plane(const uint8_t* x, uint32_t n, std::vector<uint8_t>& out)
+{
+    /* branch-free passes: distinct values, then run boundaries */
+    uint8_t  seen[256] = {};
+    uint8_t  dict[16];
+    uint32_t nDict = 0, runs = 1;
+    for(uint32_t i=0;i<n;++i) seen[x[i]] = 1;
+    for(uint32_t v=0;v<256;++v) if(seen[v]){ if(nDict < 16) dict[nDict] = uint8_t(v); ++nDict; }
+    for(uint32_t i=1;i<n;++i) runs += x[i]!=x[i-1];
+
+    const uint32_t bits     = nDict<=2 ? 1 : nDict<=4 ? 2 : 4;
+    const uint64_t dictSize = nDict<=16 ? nDict + (uint64_t(n)*bits + 7)/8 : n;
+
+    /* a constant plane (pad) or long runs: try run-length first */
+    if(nDict==1 || uint64_t(runs)*4 < dictSize){
+        const size_t at = open_stream(out, StreamMode::Rle, 0, 0);
+        rle_encode(x, n, out);
+        if(out.size() - at - kStreamHead < std::min<uint64_t>(dictSize, n)){
+            close_stream(out, at);
+            return;
+        }
+        out.resize(at);
+    }
+
+    if(nDict <= 16 && nDict > 1){
+        uint8_t code[256] = {};
+        for(uint32_t k=0;k<nDict;++k) code[dict[k]] = uint8_t(k);
+
+        const size_t at = open_stream(out, StreamMode::Dict, uint8_t(bits), uint8_t(nDict));
+        out.insert(out.end(), dict, dict + nDict);
+        const size_t p0 = out.size();
+        out.resize(p0 + (uint64_t(n)*bits + 7)/8);
+        uint8_t*       o   = out.data() + p0;
+        const uint32_t per = 8 / bits;
+        for(uint32_t i=0;i<n;i+=per){
+            uint32_t b = 0;
+            for(uint32_t j=0;j<per && i+j<n;++j) b |= uint32_t(code[x[i+j]]) << (j*bits);
+            *o++ = uint8_t(b);
+        }
+        close_stream(out, at);
+        return;
+    }
+
+    const size_t at = open_stream(out, StreamMode::Raw, 0, 0);
+    out.insert(out.end(), x, x + n);
+    close_stream(out, at);
+}
+
+/* ===================================================================== */
+/* one uint32 index column                                               */
+static void encode_index(const uint32_t* x, uint32_t n, std::vector<uint8_t>& out)
+{
+    uint32_t lo = x[0], hi = x[0], prev = 0;
+    uint64_t dv = 0;
+    for(uint32_t i=0;i<n;++i){
+        lo = std::min(lo, x[i]); hi = std::max(hi, x[i]);
+        dv  += varint_bytes(zigzag(x[i] - prev));
+        prev = x[i];
+    }
+    const uint32_t bits = hi==lo ? 0 : 32 - __builtin_clz(hi - lo);
+    const uint64_t bp   = 4 + 4*((uint64_t(n)*bits + 31)/32);
+    const uint64_t raw  = uint64_t(n)*4;
+
+    if(dv < bp && dv < raw){
+        const size_t at = open_stream(out, StreamMode::DeltaVarint, 0, 0);
+        const size_t p0 = out.size();
+        out.resize(p0 + dv);
+        uint8_t* o = out.data() + p0;
+        prev = 0;
+        for(uint32_t i=0;i<n;++i){ o = put_varint(o, zigzag(x[i] - prev)); prev = x[i]; }
+        close_stream(out, at);
+        return;
+    }
+
+    if(bp < raw){
+        const size_t at = open_stream(out, StreamMode::BitPack, uint8_t(bits), 0);
+        const size_t p0 = out.size();
+        out.resize(p0 + bp);
+        uint8_t* o = out.data() + p0;
+        st32(o, lo); o += 4;
+        uint64_t acc = 0; uint32_t fill = 0;
+        for(uint32_t i=0;i<n && bits;++i){
+            acc  |= uint64_t(x[i] - lo) << fill;
+            fill += bits;
+            if(fill >= 32){ st32(o, uint32_t(acc)); o += 4; acc >>= 32; fill -= 32; }
+        }
+        if(fill) st32(o, uint32_t(acc));
+        close_stream(out, at);
+        return;
+    }
+
+    const size_t at = open_stream(out, StreamMode::Raw, 0, 0);
+    out.insert(out.end(), reinterpret_cast<const uint8_t*>(x), reinterpret_cast<const uint8_t*>(x + n));
+    close_stream(out, at);
+}
+
+/* ===================================================================== */
+/* decode one stream of n items (bytes or uint32) into x                 */
+static bool decode_stream(const uint8_t*& p, const uint8_t* end, uint8_t* x, uint32_t n, bool index)
+{
+    if(end - p < kStreamHead) return false;
+    const StreamMode m     = StreamMode(p[0]);
+    const uint32_t   bits  = p[1], nDict = p[2];
+    const uint32_t   bytes = ld32(p + 4);
+    p += kStreamHead;
+    if(uint64_t(end - p) < bytes) return false;
+    const uint8_t* q = p;
+    const uint8_t* e = p + bytes;
+    p = e;
+
+    const uint64_t itemBytes = index ? 4 : 1;
+    switch(m){
+        case StreamMode::Raw:
+            if(bytes != n*itemBytes) return false;
+            std::memcpy(x, q, bytes);
+            return true;
+
+        case StreamMode::Rle:
+            return !index && rle_decode(q, e, x, n);
+
+        case StreamMode::Dict: {
+            if(index || !nDict || nDict > 16 || (bits!=1 && bits!=2 && bits!=4)) return false;
+            if(bytes != nDict + (uint64_t(n)*bits + 7)/8) return false;
+            uint8_t dict[16] = {};
+            std::memcpy(dict, q, nDict); q += nDict;
+            const uint32_t per  = 8 / bits;
+            const uint32_t mask = (1u<<bits) - 1;
+            uint32_t i = 0;
+            for(; i + per <= n; i += per, ++q)
+                for(uint32_t j=0;j<per;++j) x[i+j] = dict[(*q >> (j*bits)) & mask];
+            for(uint32_t j=0; i<n; ++i, ++j) x[i] = dict[(*q >> (j*bits)) & mask];
+            return true;
+        }
+
+        case StreamMode::DeltaVarint: {
+            if(!index) return false;
+            uint32_t prev = 0;
+            for(uint32_t i=0;i<n;++i){
+                uint64_t z;
+                if(!get_varint(q, e, z) || z > 0xFFFFFFFFu) return false;
+                prev += unzigzag(uint32_t(z));
+                st32(x + 4*i, prev);
+            }
+            return q==e;
+        }
+
+        case StreamMode::BitPack: {
+            if(!index || bits > 32 || bytes != 4 + 4*((uint64_t(n)*bits + 31)/32)) return false;
+            const uint32_t lo   = ld32(q); q += 4;
+            const uint64_t mask = (uint64_t(1)<<bits) - 1;
+            uint64_t acc = 0; uint32_t fill = 0;
+            for(uint32_t i=0;i<n;++i){
+                if(fill < bits){ acc |= uint64_t(ld32(q)) << fill; q += 4; fill += 32; }
+                st32(x + 4*i, lo + uint32_t(acc & mask));
+                acc >>= bits; fill -= bits;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ===================================================================== */
+/* one block: per index field one stream, per value field one per byte   */
+static void encode_block(const CodecLayout& L, const uint8_t* raw, uint32_t n,
+                         std::vector<uint8_t>& out)
+{
+    thread_local std::vector<uint32_t> col;
+    thread_local std::vector<uint8_t>  planes;
+    out.clear();
+
+    /* value bytes → byte planes in one pass over the elements */
+    uint32_t nPlanes = 0, at[16];
+    for(uint32_t f=0;f<L.nFields;++f)
+        for(uint32_t b=0;b<L.field[f].bytes && !L.field[f].index;++b) at[nPlanes++] = L.field[f].offset + b;
+    planes.resize(uint64_t(nPlanes)*n);
+    col.resize(n);
+    for(uint32_t i=0;i<n;++i){
+        const uint8_t* e = raw + uint64_t(i)*L.elemBytes;
+        for(uint32_t k=0;k<nPlanes;++k) planes[uint64_t(k)*n + i] = e[at[k]];
+    }
+
+    uint32_t k = 0;
+    for(uint32_t f=0;f<L.nFields;++f){
+        const CodecField& F = L.field[f];
+        if(F.index){
+            for(uint32_t i=0;i<n;++i) col[i] = ld32(raw + uint64_t(i)*L.elemBytes + F.offset);
+            encode_index(col.data(), n, out);
+            continue;
+        }
+        for(uint32_t b=0;b<F.bytes;++b,++k) encode_plane(planes.data() + uint64_t(k)*n, n, out);
+    }
+}
+
+static bool decode_block(const CodecLayout& L, const uint8_t* p, const uint8_t* end,
+                         uint8_t* raw, uint32_t n)
+{
+    thread_local std::vector<uint8_t> tmp;
+    tmp.resize(uint64_t(n)*4);
+
+    for(uint32_t f=0;f<L.nFields;++f){
+        const CodecField& F = L.field[f];
+        if(F.index){
+            if(!decode_stream(p, end, tmp.data(), n, true)) return false;
+            if(L.elemBytes==4) std::memcpy(raw, tmp.data(), uint64_t(n)*4);
+            else for(uint32_t i=0;i<n;++i) std::memcpy(raw + uint64_t(i)*L.elemBytes + F.offset, &tmp[4*i], 4);
+            continue;
+        }
+        for(uint32_t b=0;b<F.bytes;++b){
+            if(!decode_stream(p, end, tmp.data(), n, false)) return false;
+            uint8_t* d = raw + F.offset + b;
+            for(uint32_t i=0;i<n;++i) d[uint64_t(i)*L.elemBytes] = tmp[i];
+        }
+    }
+    return p==end;
+}
+
+/* ===================================================================== */
+/* blocks are dealt round-robin so a short last block does not idle     */
+/* one worker                                                            */
+template<class Fn>
+static void for_each_block(ThreadPool* pool, uint64_t nBlocks, Fn&& fn)
+{
+    if(!pool || pool->size()==1 || nBlocks==1){
+        for(uint64_t b=0;b<nBlocks;++b) fn(b);
+        return;
+    }
+    const uint32_t T = pool->size();
+    pool->run([&](uint32_t w){
+        for(uint64_t b=w;b<nBlocks;b+=T) fn(b);
+    });
+}
+
+void codec_encode_blocks(ThreadPool* pool, const CodecLayout& L,
+                         const uint8_t* raw, uint64_t nElems,
+                         std::vector<std::vector<uint8_t>>& out)
+{
+    const uint64_t nBlocks = (nElems + kCodecBlock - 1) / kCodecBlock;
+    out.resize(nBlocks);
+    for_each_block(pool, nBlocks, [&](uint64_t b){
+        const uint64_t i0 = b*kCodecBlock;
+        encode_block(L, raw + i0*L.elemBytes, uint32_t(std::min<uint64_t>(kCodecBlock, nElems-i0)), out[b]);
+    });
+}
+
+bool codec_decode_blocks(ThreadPool* pool, const CodecLayout& L,
+                         const uint8_t* enc, const uint64_t* at,
+                         uint8_t* raw, uint64_t nElems)
+{
+    const uint64_t nBlocks = (nElems + kCodecBlock - 1) / kCodecBlock;
+    std::vector<uint8_t> ok(nBlocks, 0);
+    for_each_block(pool, nBlocks, [&](uint64_t b){
+        const uint64_t i0 = b*kCodecBlock;
+        ok[b] = at[b] <= at[b+1]
+             && decode_block(L, enc + at[b], enc + at[b+1], raw + i0*L.elemBytes,
+                             uint32_t(std::min<uint64_t>(kCodecBlock, nElems-i0)));
+    });
+    return std::all_of(ok.begin(), ok.end(), [](uint8_t v){ return v; });
+}
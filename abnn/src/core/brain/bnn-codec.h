@@ -0,0 +1,56 @@
+#pragma once
+/* bnn-codec.h  –  lossless block codec for .bnn synapse sections
+ * ====================================================================
+ * * An array of fixed-size elements is cut into blocks of
+ *   kCodecBlock elements that are coded independently, so blocks encode
+ *   and decode in parallel on the worker pool
+ * * Each element is split into fields, and each block stores one
+ *   stream per index field and one per byte plane of a value field;
+ *   every stream picks the smallest of
+ *     Raw         – as is
+ *     DeltaVarint – zigzag delta to the previous index, LEB128 (sorted
+ *                   src, the dense input→output block)
+ *     BitPack     – minimum + fixed bit width (random indices only use
+ *                   log2(N_NRN) of their 32 bits)
+ *     Rle         – byte runs (pad, saturated weights)
+ *     Dict        – ≤ 16 distinct bytes as 1/2/4-bit codes (exponent
+ *                   plane of weights clustered in one octave)
+ * * Byte planes shuffle a value field so equal high bytes of
+ *   neighbouring weights sit together
+ * * Pure memory: framing in the file is done by brain-io.cpp
+ */
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+static constexpr uint32_t kCodecBlock = 1u<<16;    /* elements per block */
+
+/* one field of an element; index fields are uint32 */
+struct CodecField
+{
+    uint32_t offset;
+    uint32_t bytes;
+    bool     index;
+};
+
+struct CodecLayout
+{
+    uint32_t   elemBytes{0};
+    uint32_t   nFields{0};
+    CodecField field[4]{};
+};
+
+/* nElems elements of raw → ceil(nElems / kCodecBlock) blocks in out;
+   block i holds elements [i·kCodecBlock, …). pool nullptr → calling
+   thread only                                                         */
+void codec_encode_blocks(ThreadPool* pool, const CodecLayout& layout,
+                         const uint8_t* raw, uint64_t nElems,
+                         std::vector<std::vector<uint8_t>>& out);
+
+/* the inverse: block i is enc[at[i] .. at[i+1]) and decodes to raw
+   elements [i·kCodecBlock, …); false → a block is malformed           */
+bool codec_decode_blocks(ThreadPool* pool, const CodecLayout& layout,
+                         const uint8_t* enc, const uint64_t* at,
+                         uint8_t* raw, uint64_t nElems);
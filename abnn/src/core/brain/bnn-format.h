@@ -0,0 +1,147 @@
+#pragma once
+/* bnn-format.h  –  on-disk layout of .bnn model files
+ * ====================================================================
+ * * v1 (legacy, no magic): uint32 nSyn, uint32 nNrn, SynapsePacked[nSyn]
+ * * v2 (read only): BnnHeader, then the synapse payload exactly as the
+ *   writer held it in memory
+ *     Packed → SynapsePacked[nSyn]
+ *     SoA    → uint32 src[nSyn], uint32 dst[nSyn], weights[nSyn] in
+ *              weightFormat (u8 codes are relative to [wLo, wHi])
+ * * v3 (written): self-describing container
+ *     BnnFileHeader (64 B)      magic, version, layout/format flags,
+ *                               sizes, checksum of header + table
+ *     BnnSectionEntry[n] (32 B) id, offset, bytes, XXH64 of the bytes
+ *     sections, each starting on a 64-byte boundary so a mapped file
+ *     can be used in place (Synapses or Src/Dst/Weights, State,
+ *     LastFired, LastVisit); readers skip ids they do not know
+ *     synapse sections may be block-coded (kBnnCoded): smaller, read
+ *     through bnn-codec.h, never mapped in place
+ * * v3 delta (header flag kBnnDelta): no synapse sections; DeltaInfo
+ *   names the parent file by its header checksum, DirtyBlocks lists the
+ *   changed blocks of blockSyn synapses and BlockWeights holds their
+ *   weights (writer's format, f32 for packed) in that order, followed
+ *   by the usual state sections. A chain base → d1 → d2 … is applied in
+ *   order; each link must name the previous file
+ * * E/I brains add NeuronTypes and LastInhibit to the state sections;
+ *   a file without them is homogeneous (every neuron excitatory)
+ * * Structural plasticity: nSyn counts slots; a free slot is stored
+ *   as {kFreeSyn, kFreeSyn, 0, 0} and the header's nLive counts the
+ *   others, so a full file (nLive = nSyn) is never scanned for them
+ * * A reader with a different layout / format converts chunk-wise
+ * * All fields little-endian; the first word tells the versions apart
+ *   (a v1 file would need exactly 0x4E4E4241 synapses to collide)
+ */
+
+#include <cstdint>
+
+static constexpr uint32_t kBnnMagic   = 0x4E4E4241u;   /* "ABNN" */
+static constexpr uint32_t kBnnVersion = 3;             /* written  */
+static constexpr uint32_t kBnnAlign   = 64;            /* sections */
+
+/* v2 ------------------------------------------------------------------- */
+struct BnnHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nSyn;
+    uint32_t nNrn;
+    uint32_t layout;          /* SynapseLayout */
+    uint32_t weightFormat;    /* WeightFormat  */
+    float    wLo, wHi;
+};
+static_assert(sizeof(BnnHeader)==32, "BnnHeader is part of the file format");
+
+/* v3 ------------------------------------------------------------------- */
+enum class BnnSectionId : uint32_t
+{
+    Synapses     = 1,         /* SynapsePacked[nSyn]            */
+    Src          = 2,         /* uint32[nSyn]                   */
+    Dst          = 3,         /* uint32[nSyn]                   */
+    Weights      = 4,         /* nSyn × weight_bytes(format)    */
+    State        = 5,         /* BnnState                       */
+    LastFired    = 6,         /* uint32[nNrn]                   */
+    LastVisit    = 7,         /* uint32[nNrn]                   */
+    DeltaInfo    = 8,         /* BnnDeltaInfo                   */
+    DirtyBlocks  = 9,         /* uint32[nBlocks], ascending     */
+    BlockWeights = 10,        /* weights of those blocks        */
+    NeuronTypes  = 11,        /* uint8[nNrn], NeuronType        */
+    LastInhibit  = 12,        /* uint32[nNrn]                   */
+};
+
+/* flags: bits 0-7 SynapseLayout, bits 8-15 WeightFormat, kBnnDelta */
+static constexpr uint32_t kBnnDelta = 1u<<16;
+
+inline uint32_t bnn_flags(uint32_t layout, uint32_t wfmt) { return layout | wfmt<<8; }
+inline uint32_t bnn_layout(uint32_t flags)                { return flags & 0xFFu; }
+inline uint32_t bnn_weight_format(uint32_t flags)         { return (flags>>8) & 0xFFu; }
+
+struct BnnFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+    uint32_t nSections;
+    uint64_t nSyn;
+    uint32_t nNrn;
+    uint32_t nInput;
+    uint32_t nOutput;
+    float    wLo, wHi;
+    uint32_t reserved0;
+    uint64_t checksum;        /* XXH64 of this header (checksum = 0)
+                                 followed by the section table        */
+    uint64_t nLive;           /* synapses not in free slots, 0 → all
+                                 (files written before free slots)    */
+};
+static_assert(sizeof(BnnFileHeader)==64, "BnnFileHeader is part of the file format");
+
+/* section flags */
+static constexpr uint32_t kBnnUnchecked = 1u;   /* checksum not kept up
+                                                   (rewritten in place) */
+static constexpr uint32_t kBnnCoded     = 2u;   /* block codec, see below */
+
+struct BnnSectionEntry
+{
+    uint32_t id;              /* BnnSectionId */
+    uint32_t flags;
+    uint64_t offset;          /* from the start of the file, 64-aligned */
+    uint64_t bytes;
+    uint64_t checksum;        /* XXH64 of the section bytes */
+};
+static_assert(sizeof(BnnSectionEntry)==32, "BnnSectionEntry is part of the file format");
+
+/* dynamic state needed to resume a run exactly */
+struct BnnState
+{
+    uint32_t clock;
+    float    rBar;
+    float    reward;
+    uint32_t reserved;
+    uint64_t pass;            /* Philox counter */
+    uint32_t key0, key1;      /* Philox key     */
+};
+static_assert(sizeof(BnnState)==32, "BnnState is part of the file format");
+
+/* parent of a delta file */
+struct BnnDeltaInfo
+{
+    uint64_t parent;          /* BnnFileHeader::checksum of the parent */
+    uint32_t blockSyn;        /* synapses per dirty block              */
+    uint32_t nBlocks;
+};
+static_assert(sizeof(BnnDeltaInfo)==16, "BnnDeltaInfo is part of the file format");
+
+/* a kBnnCoded synapse section: BnnCodecHeader, the encoded blocks back
+   to back (bnn-codec.h), then uint32 blockBytes[nBlocks]; the section
+   checksum covers all three in that order                             */
+static constexpr uint32_t kBnnCodec = 1;
+
+struct BnnCodecHeader
+{
+    uint32_t codec;           /* kBnnCodec   */
+    uint32_t elemBytes;
+    uint32_t blockElems;      /* kCodecBlock */
+    uint32_t nBlocks;
+    uint64_t nElems;
+    uint64_t reserved;
+};
+static_assert(sizeof(BnnCodecHeader)==32, "BnnCodecHeader is part of the file format");
@@ -0,0 +1,153 @@
+// brain-ei.cpp  –  excitatory / inhibitory neuron types and the runs of
+//                  synapse slots by source type
+// ======================================================================
+
+#include "brain.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "thread-pool.h"
+
+static constexpr uint64_t kNoHole = ~uint64_t(0);
+
+/* ===================================================================== */
+void Brain::set_inhibitory(float frac)
+{
+    assert(cpu_ && "E/I runs on the CPU kernels");
+    const uint32_t nInh = uint32_t(std::lround(std::clamp(frac, 0.f, 1.f)*double(N_HIDDEN_)));
+
+    enable_types(nInh > 0);
+    if(nInh){
+        std::fill(types_.begin(), types_.end() - nInh, NeuronType::Exc);
+        std::fill(types_.end() - nInh, types_.end(), NeuronType::Inh);
+    }
+    nInh_ = nInh;
+    index_types();
+}
+
+void Brain::enable_types(bool on)
+{
+    if(!on){
+        types_.clear(); types_.shrink_to_fit();
+        typeRuns_.clear();
+        hostLastInhibit_.release();
+        lastI_ = nullptr;
+        nInh_  = 0;
+        return;
+    }
+    if(!types_.empty()) return;
+
+    types_.assign(N_NRN_, NeuronType::Exc);
+    hostLastInhibit_.allocate(N_NRN_, hostLastFire_.pages(), NRN_CAP_);
+    lastI_ = hostLastInhibit_.data();
+    std::fill(lastI_, lastI_ + N_NRN_, *clock_ - kInhibit - kClockInc);
+    cpu_->place_shared(lastI_, uint64_t(N_NRN_)*sizeof(uint32_t),
+                       host_page_bytes(hostLastInhibit_.pages()));
+}
+
+/* ===================================================================== */
+/* one more run of slots [first, end): merged into the last run when the
+   type is the same, otherwise the last run ends where this one starts,
+   so free slots in between belong to the run before them; the first
+   run starts at slot 0                                                */
+static void push_run(std::vector<TypeRun>& runs, TypeRun r)
+{
+    if(runs.empty())                 runs.push_back({ 0, r.end, r.type });
+    else if(runs.back().type==r.type) runs.back().end = r.end;
+    else { runs.back().end = r.first; runs.push_back(r); }
+}
+
+void Brain::index_types()
+{
+    typeRuns_.clear();
+    if(types_.empty()) return;
+
+    /* sorted by source: one step per row, not per synapse */
+    if(!srcIndex_.empty()){
+        const uint64_t* rowPtr = srcIndex_.offsets();
+        for(uint32_t n=0;n<N_NRN_;++n)
+            if(rowPtr[n+1] > rowPtr[n]) push_run(typeRuns_, { rowPtr[n], rowPtr[n+1], types_[n] });
+        return;
+    }
+    append_type_runs(0, end_);
+}
+
+/* every worker lists the runs of its shard's live synapses, then the
+   lists are chained in shard order                                    */
+void Brain::append_type_runs(uint64_t first, uint64_t end)
+{
+    assert(typeRuns_.empty() || typeRuns_.back().end==first);
+    if(types_.empty() || end <= first) return;
+
+    std::vector<std::vector<TypeRun>> part(cpu_->pool().size());
+    cpu_->pool().parallel_for(end - first, [&](uint64_t b, uint64_t e, uint32_t w){
+        auto& runs = part[w];
+        runs.clear();
+        for(uint64_t i=first+b;i<first+e;++i){
+            const uint32_t s = syn_.src(i);
+            if(s==kFreeSyn) continue;
+            const NeuronType t = types_[s];
+            if(runs.empty() || runs.back().type!=t) runs.push_back({ i, i+1, t });
+            else                                    runs.back().end = i+1;
+        }
+    });
+
+    for(const auto& runs : part)
+        for(const TypeRun& r : runs) push_run(typeRuns_, r);
+    if(!typeRuns_.empty()) typeRuns_.back().end = end;
+}
+
+void Brain::clip_type_runs()
+{
+    while(!typeRuns_.empty() && typeRuns_.back().first >= end_) typeRuns_.pop_back();
+    if(!typeRuns_.empty()) typeRuns_.back().end = std::min(typeRuns_.back().end, end_);
+}
+
+/* ===================================================================== */
+/* synaptogenesis with types: a new synapse only takes a hole inside a
+   run of its source's type (lowest first), the rest go to the tail, the
+   last run's type first; the runs stay valid without a rescan          */
+uint64_t Brain::place_typed(const std::vector<std::vector<SynapsePacked>>& born)
+{
+    uint64_t grown = 0;
+    std::vector<SynapsePacked> tail[2];
+
+    for(NeuronType t : { NeuronType::Exc, NeuronType::Inh }){
+        size_t   r = 0;
+        uint64_t i = 0;
+        auto hole = [&]() -> uint64_t {
+            for(; r<typeRuns_.size(); ++r){
+                const TypeRun& run = typeRuns_[r];
+                if(run.type!=t) continue;
+                for(i=std::max(i, run.first); i<run.end; ){
+                    const uint64_t b = i >> kDirtyShift;
+                    if(!blockFree_[b])       { i = (b+1) << kDirtyShift; continue; }
+                    if(syn_.is_free(i)){ --blockFree_[b]; return i++; }
+                    ++i;
+                }
+            }
+            return kNoHole;
+        };
+        for(const auto& list : born)
+            for(const SynapsePacked& s : list){
+                if(types_[s.src]!=t) continue;
+                const uint64_t slot = hole();
+                if(slot==kNoHole){ tail[int(t)].push_back(s); continue; }
+                syn_.set(slot, s);
+                ++grown;
+            }
+    }
+
+    const int last = typeRuns_.empty() ? 0 : int(typeRuns_.back().type);
+    for(int k : { last, 1-last })
+        for(const SynapsePacked& s : tail[k]){
+            if(end_ >= N_SYN_) return grown;             /* at capacity */
+            push_run(typeRuns_, { end_, end_+1, NeuronType(k) });
+            syn_.set(end_++, s);
+            ++grown;
+        }
+    return grown;
+}
@@ -0,0 +1,145 @@
+// brain-grow.cpp  –  online growth: hidden neurons and synapse slots
+//                    appended in place
+// ======================================================================
+
+#include "brain.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "thread-pool.h"
+
+static constexpr uint64_t kGrowBatch = 1u<<12;      /* synapses per philox_fill */
+
+/* ===================================================================== */
+/* every array was mapped with room for the capacity (host-array.h), so
+   growing opens pages behind the current end and moves nothing: the
+   pause is O(new neurons + new synapses), not O(model)                */
+bool Brain::grow_storage(uint32_t nHidden, uint32_t nSyn)
+{
+    if(!cpu_ || syn_.frozen()) return false;
+    if(nHidden < N_HIDDEN_ || nSyn < N_SYN_ || nSyn > SYN_CAP_) return false;
+    if(uint64_t(N_INPUT_) + N_OUTPUT_ + nHidden > NRN_CAP_)      return false;
+    const uint32_t nNrn = N_INPUT_ + N_OUTPUT_ + nHidden;
+
+    if(!syn_.grow(nSyn)) return false;
+    if(!hostLastFire_.grow(nNrn) || !hostLastVisit_.grow(nNrn)) return false;
+    assert(lastF_==hostLastFire_.data() && lastV_==hostLastVisit_.data());
+
+    /* never fired: old enough to be neither recent nor refractory */
+    const uint32_t never = *clock_ - std::max(kWindowPre, kRefractory) - kClockInc;
+    std::fill(lastF_ + N_NRN_, lastF_ + nNrn, never);
+
+    /* E/I: excitatory until the caller says otherwise, never hit */
+    if(!types_.empty()){
+        if(!hostLastInhibit_.grow(nNrn)) return false;
+        std::fill(lastI_ + N_NRN_, lastI_ + nNrn, *clock_ - kInhibit - kClockInc);
+        types_.resize(nNrn, NeuronType::Exc);
+    }
+
+    /* a budget that covered every slot keeps covering them */
+    if(EVENTS_ >= N_SYN_) EVENTS_ = nSyn;
+
+    N_HIDDEN_ = nHidden;
+    N_NRN_    = nNrn;
+    N_SYN_    = nSyn;
+    blockFree_.resize((uint64_t(N_SYN_) + kDirtyBlock-1) >> kDirtyShift, 0);
+    return true;
+}
+
+/* ===================================================================== */
+/* the new block [end_, end_ + 2·n·degree) comes out in source order:
+   first the in-synapses, existing hidden neuron s sending ⌊n·degree/H⌋
+   or one more (closed-form offsets, as in build_row_graph) to uniform
+   new neurons, then the degree out-synapses of each new neuron to
+   uniform hidden ones. Slot j draws word j&3 of Philox counter j/4 on
+   kStreamGrow with the first new id as pass: thread-count free.
+   E/I: the new neurons keep the inhibitory share, excitatory ids first;
+   in a dense store the in-synapses take their sources excitatory ones
+   first, so the block adds four type runs whatever the id layout      */
+GrowStats Brain::grow_neurons(uint32_t n, uint32_t degree, float wInit)
+{
+    assert(cpu_ && "online growth runs on the host pool");
+    const auto t0 = std::chrono::steady_clock::now();
+    GrowStats gs;
+    if(!n || !N_HIDDEN_) return gs;
+    if(syn_.frozen()){ gs.deferred = true; return gs; }   /* writer reads the store */
+
+    const uint32_t h0    = N_INPUT_ + N_OUTPUT_;
+    const uint32_t v0    = N_NRN_;
+    const uint32_t nOld  = N_HIDDEN_;
+    const uint64_t nIn   = uint64_t(n)*degree;
+    const uint64_t first = end_;
+    const uint64_t need  = first + 2*nIn;
+    if(need > SYN_CAP_ || uint64_t(v0) + n > NRN_CAP_) return gs;
+
+    /* slots past end_ are free; only what is beyond N_SYN_ is new */
+    if(!grow_storage(N_HIDDEN_ + n, uint32_t(std::max<uint64_t>(N_SYN_, need)))) return gs;
+
+    /* E/I: new inhibitory neurons last, sources in type order */
+    std::vector<uint32_t> order;
+    if(!types_.empty()){
+        const uint32_t nI = uint32_t(std::llround(double(n)*nInh_/nOld));
+        std::fill(types_.end() - nI, types_.end(), NeuronType::Inh);
+        nInh_ += nI;
+        if(srcIndex_.empty()){
+            order.reserve(nOld);
+            for(NeuronType t : { NeuronType::Exc, NeuronType::Inh })
+                for(uint32_t h=h0;h<v0;++h) if(types_[h]==t) order.push_back(h);
+        }
+    }
+    auto source = [&](uint64_t s){ return order.empty() ? h0 + uint32_t(s) : order[s]; };
+
+    const SynapseView v  = syn_.view();
+    const uint32_t    nH = N_HIDDEN_;
+    const uint64_t    q  = nIn / nOld, r = nIn % nOld;
+    auto off = [&](uint64_t h){ return h < nOld ? h*q + std::min(h, r) : nIn; };
+    auto put = [&](uint64_t i, uint32_t src, uint32_t dst){
+        if(v.layout==SynapseLayout::Packed){ v.pk[i] = { src, dst, wInit, 0.f }; return; }
+        v.src[i] = src; v.dst[i] = dst;
+        syn_.set_weight(i, wInit, kRoundNearest);
+    };
+    auto scale = [](uint32_t x, uint32_t m){ return uint32_t((uint64_t(x)*m) >> 32); };
+
+    /* the source of slot j is tracked along the shard, not divided out */
+    cpu_->pool().parallel_for(2*nIn, [&](uint64_t b, uint64_t e, uint32_t){
+        std::vector<uint32_t> x(kGrowBatch + 8);
+        uint64_t s  = b < nIn ? (b < r*(q+1) ? b/(q+1) : r + (b - r*(q+1))/q) : 0;
+        uint64_t sE = off(s+1);
+        uint64_t o  = b < nIn ? 0 : (b - nIn)/degree;
+        uint64_t oE = nIn + (o+1)*degree;
+        for(uint64_t j0=b; j0<e; j0+=kGrowBatch){
+            const uint64_t k  = std::min(kGrowBatch, e-j0);
+            const uint64_t c0 = j0/4;
+            philox_fill(key_, kStreamGrow, v0, c0, (j0+k+3)/4*4 - 4*c0, x.data());
+            const uint32_t* xj = x.data() + (j0 - 4*c0);
+            for(uint64_t t=0;t<k;++t){
+                const uint64_t j = j0+t;
+                if(j < nIn){
+                    while(j >= sE) sE = off(++s + 1);
+                    put(first+j, source(s), v0 + scale(xj[t], n));
+                } else {
+                    if(j >= oE){ ++o; oE += degree; }
+                    put(first+j, v0 + uint32_t(o), h0 + scale(xj[t], nH));
+                }
+            }
+        }
+    });
+
+    nLive_ += 2*nIn;
+    end_    = need;
+    syn_.mark_restructured();
+
+    /* active set: merged into the rows, not re-sorted; dense: only the
+       new block is scanned for its type runs                          */
+    if(srcIndex_.empty()){ append_type_runs(first, need); place_numa(); }
+    else { srcIndex_.append(syn_, first, need, N_NRN_); index_types(); place_numa(); }
+
+    gs.neurons  = n;
+    gs.synapses = 2*nIn;
+    gs.seconds  = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+    return gs;
+}
@@ -0,0 +1,877 @@
+// brain-io.cpp  –  .bnn persistence: v1 / v2 read, v3 read + write
+// ======================================================================
+
+#include "brain.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <vector>
+
+#include "bnn-codec.h"
+#include "bnn-format.h"
+#include "checksum.h"
+#include "thread-pool.h"
+
+/* .bnn payload mirrors the store; mismatches convert in bounded chunks */
+static constexpr uint64_t kIoChunk = 1u<<20;     /* synapses per chunk  */
+static constexpr uint64_t kIoBytes = 1u<<26;     /* bytes per read/write */
+static_assert(kIoChunk % kCodecBlock==0, "conversion chunks are whole codec blocks");
+
+/* positional read: false → short read / out of range */
+using ReadAt = BnnReadAt;
+
+/* ===================================================================== */
+/* what a file holds, whatever its version                               */
+struct BnnInfo
+{
+    uint32_t      version{0};
+    uint64_t      nSyn{0};
+    uint32_t      nNrn{0};
+    uint32_t      nInput{0}, nOutput{0};      /* v3 only, 0 = unknown  */
+    SynapseLayout layout{SynapseLayout::Packed};
+    WeightFormat  wfmt{WeightFormat::F32};
+    float         wLo{0.f}, wHi{1.f};
+    uint64_t      off[3]{};                   /* packed: [0]; SoA: src, dst, weights */
+    const BnnSectionEntry* syn[3]{};          /* v3: entries behind off[] */
+    bool          delta{false};               /* v3 delta: no synapses */
+    BnnFileHeader header{};                   /* v3 */
+    std::vector<BnnSectionEntry> table;       /* v3 */
+
+    const BnnSectionEntry* find(BnnSectionId id) const
+    {
+        for(auto& e : table) if(e.id==uint32_t(id)) return &e;
+        return nullptr;
+    }
+};
+
+/* bytes per synapse of array a (packed: one array) */
+static uint64_t elem_bytes(SynapseLayout layout, WeightFormat wfmt, int a)
+{
+    if(layout==SynapseLayout::Packed) return sizeof(SynapsePacked);
+    return a<2 ? 4 : weight_bytes(wfmt);
+}
+
+static int n_arrays(SynapseLayout layout) { return layout==SynapseLayout::Packed ? 1 : 3; }
+
+/* fields of array a for the block codec */
+static CodecLayout codec_layout(SynapseLayout layout, WeightFormat wfmt, int a)
+{
+    CodecLayout c;
+    c.elemBytes = uint32_t(elem_bytes(layout, wfmt, a));
+    if(layout==SynapseLayout::Packed){
+        c.nFields  = 4;
+        c.field[0] = { offsetof(SynapsePacked, src), 4, true  };
+        c.field[1] = { offsetof(SynapsePacked, dst), 4, true  };
+        c.field[2] = { offsetof(SynapsePacked, w),   4, false };
+        c.field[3] = { offsetof(SynapsePacked, pad), 4, false };
+    } else {
+        c.nFields  = 1;
+        c.field[0] = { 0, c.elemBytes, a<2 };
+    }
+    return c;
+}
+
+static const BnnSectionId kSynSection[2][3] = {
+    { BnnSectionId::Synapses },
+    { BnnSectionId::Src, BnnSectionId::Dst, BnnSectionId::Weights },
+};
+
+/* XXH64 of header (checksum field zeroed) + table */
+static uint64_t header_checksum(BnnFileHeader h, const std::vector<BnnSectionEntry>& table)
+{
+    h.checksum = 0;
+    Checksum64 c;
+    c.update(&h, sizeof(h));
+    c.update(table.data(), table.size()*sizeof(BnnSectionEntry));
+    return c.digest();
+}
+
+/* ===================================================================== */
+/* header + section table; false → not a file this build can read        */
+static bool parse_bnn(const ReadAt& rd, BnnInfo& f)
+{
+    uint32_t w[2];
+    if(!rd(0, w, 8)) return false;
+
+    /* v1 files start with nSyn, later versions with the magic */
+    if(w[0]!=kBnnMagic){
+        f.version = 1; f.nSyn = w[0]; f.nNrn = w[1];
+        f.off[0]  = 8;
+        return true;
+    }
+
+    if(w[1]==2){
+        BnnHeader h;
+        if(!rd(0, &h, sizeof(h))) return false;
+        f.version = 2; f.nSyn = h.nSyn; f.nNrn = h.nNrn;
+        f.layout  = SynapseLayout(h.layout); f.wfmt = WeightFormat(h.weightFormat);
+        f.wLo = h.wLo; f.wHi = h.wHi;
+        /* arrays back to back after the header */
+        uint64_t o = sizeof(h);
+        for(int a=0;a<n_arrays(f.layout);++a){ f.off[a] = o; o += f.nSyn*elem_bytes(f.layout, f.wfmt, a); }
+        return true;
+    }
+
+    if(w[1]!=kBnnVersion) return false;
+    BnnFileHeader& h = f.header;
+    if(!rd(0, &h, sizeof(h)) || h.nSections > 64) return false;
+    f.table.resize(h.nSections);
+    if(!rd(sizeof(h), f.table.data(), h.nSections*sizeof(BnnSectionEntry))) return false;
+    if(header_checksum(h, f.table)!=h.checksum) return false;
+
+    f.version = h.version; f.nSyn = h.nSyn; f.nNrn = h.nNrn;
+    f.nInput  = h.nInput;  f.nOutput = h.nOutput;
+    f.layout  = SynapseLayout(bnn_layout(h.flags));
+    f.wfmt    = WeightFormat(bnn_weight_format(h.flags));
+    f.wLo = h.wLo; f.wHi = h.wHi;
+    f.delta   = h.flags & kBnnDelta;
+
+    for(int a=0;a<n_arrays(f.layout) && !f.delta;++a){
+        const BnnSectionEntry* e = f.find(kSynSection[f.layout==SynapseLayout::SoA][a]);
+        if(!e) return false;
+        if(!(e->flags & kBnnCoded) && e->bytes!=f.nSyn*elem_bytes(f.layout, f.wfmt, a)) return false;
+        f.off[a] = e->offset;
+        f.syn[a] = e;
+    }
+    return true;
+}
+
+static bool coded(const BnnInfo& f)
+{
+    for(auto* e : f.syn) if(e && (e->flags & kBnnCoded)) return true;
+    return false;
+}
+
+/* read [off, off+n) into dst in kIoBytes steps; chunk i is hashed on a
+   helper thread while chunk i+1 is read, so I/O and hashing overlap   */
+static bool read_hashed(const ReadAt& rd, uint64_t off, void* dst, uint64_t n, Checksum64& c)
+{
+    uint8_t* p = static_cast<uint8_t*>(dst);
+    std::future<void> hashing;
+    for(uint64_t i=0;i<n;i+=kIoBytes){
+        const uint64_t k = std::min(kIoBytes, n-i);
+        const bool ok = rd(off+i, p+i, k);
+        if(hashing.valid()) hashing.get();
+        if(!ok) return false;
+        hashing = std::async(std::launch::async, [&c, q=p+i, k]{ c.update(q, k); });
+    }
+    if(hashing.valid()) hashing.get();
+    return true;
+}
+
+/* write n bytes in kIoBytes steps, hashing each chunk while it is written */
+static void write_hashed(std::ostream& os, const void* src, uint64_t n, Checksum64& c)
+{
+    const char* p = static_cast<const char*>(src);
+    for(uint64_t i=0;i<n;i+=kIoBytes){
+        const uint64_t k = std::min(kIoBytes, n-i);
+        auto hashing = std::async(std::launch::async, [&c, p, i, k]{ c.update(p+i, k); });
+        os.write(p+i, std::streamsize(k));
+        hashing.get();
+    }
+}
+
+/* section e (if present) into dst, verified; false → missing, wrong size
+   or corrupt                                                            */
+static bool read_section(const ReadAt& rd, const BnnSectionEntry* e, void* dst, uint64_t bytes)
+{
+    if(!e || e->bytes!=bytes) return false;
+    Checksum64 c;
+    if(!read_hashed(rd, e->offset, dst, bytes, c)) return false;
+    return (e->flags & kBnnUnchecked) || c.digest()==e->checksum;
+}
+
+/* checksum of a section without keeping it, kIoBytes at a time */
+static bool verify_section(const ReadAt& rd, const BnnSectionEntry* e, uint64_t bytes)
+{
+    if(!e || e->bytes!=bytes) return false;
+    std::vector<uint8_t> buf(std::min<uint64_t>(bytes, kIoBytes));
+    Checksum64 c;
+    for(uint64_t at=0; at<bytes; at+=kIoBytes){
+        const uint64_t n = std::min<uint64_t>(kIoBytes, bytes-at);
+        if(!rd(e->offset+at, buf.data(), n)) return false;
+        c.update(buf.data(), n);
+    }
+    return (e->flags & kBnnUnchecked) || c.digest()==e->checksum;
+}
+
+/* ===================================================================== */
+/* one synapse array of a file, read front to back in element ranges.
+   A coded section is read a group of blocks at a time and decoded on
+   the pool; either way the bytes are hashed in file order            */
+class SectionReader
+{
+public:
+    SectionReader(const ReadAt& rd, ThreadPool* pool) : rd_(rd), pool_(pool) {}
+
+    bool open(const BnnInfo& f, int a)
+    {
+        layout_ = codec_layout(f.layout, f.wfmt, a);
+        nElems_ = f.nSyn;
+        off_    = f.off[a];
+        entry_  = f.syn[a];
+        if(!entry_ || !(entry_->flags & kBnnCoded)) return true;
+
+        BnnCodecHeader h;
+        const uint64_t nBlocks = (nElems_ + kCodecBlock - 1) / kCodecBlock;
+        if(entry_->bytes < sizeof(h) + nBlocks*4 || !rd_(off_, &h, sizeof(h))) return false;
+        if(h.codec!=kBnnCodec || h.elemBytes!=layout_.elemBytes || h.blockElems!=kCodecBlock
+           || h.nBlocks!=nBlocks || h.nElems!=nElems_) return false;
+
+        dir_.resize(nBlocks);
+        const uint64_t dirAt = off_ + entry_->bytes - nBlocks*4;
+        if(!rd_(dirAt, dir_.data(), nBlocks*4)) return false;
+        at_.resize(nBlocks + 1);
+        at_[0] = off_ + sizeof(h);
+        for(uint64_t b=0;b<nBlocks;++b) at_[b+1] = at_[b] + dir_[b];
+        if(at_[nBlocks]!=dirAt) return false;
+
+        sum_.update(&h, sizeof(h));
+        return true;
+    }
+
+    /* next n elements into dst; a coded section needs n to be a whole
+       number of blocks except at the end of the array                 */
+    bool read(void* dst, uint64_t n)
+    {
+        const uint64_t eb = layout_.elemBytes;
+        if(at_.empty()){
+            if(!read_hashed(rd_, off_ + pos_*eb, dst, n*eb, sum_)) return false;
+            pos_ += n;
+            return true;
+        }
+
+        assert(pos_ % kCodecBlock==0 && (n % kCodecBlock==0 || pos_+n==nElems_));
+        uint8_t*       out = static_cast<uint8_t*>(dst);
+        const uint64_t end = (pos_ + n + kCodecBlock - 1) / kCodecBlock;
+        for(uint64_t b = pos_/kCodecBlock; b<end; ){
+            /* as many blocks as fit one I/O chunk, at least one */
+            uint64_t g = 1;
+            while(b+g < end && at_[b+g+1] - at_[b] <= kIoBytes) ++g;
+
+            buf_.resize(at_[b+g] - at_[b]);
+            if(!read_hashed(rd_, at_[b], buf_.data(), buf_.size(), sum_)) return false;
+            rel_.resize(g + 1);
+            for(uint64_t i=0;i<=g;++i) rel_[i] = at_[b+i] - at_[b];
+
+            const uint64_t e0 = b*kCodecBlock;
+            const uint64_t ne = std::min((b+g)*kCodecBlock, nElems_) - e0;
+            if(!codec_decode_blocks(pool_, layout_, buf_.data(), rel_.data(),
+                                    out + (e0 - pos_)*eb, ne)) return false;
+            b += g;
+        }
+        pos_ += n;
+        return true;
+    }
+
+    /* whole array read: checksum of a v3 section */
+    bool verify()
+    {
+        if(!entry_) return true;
+        if(!dir_.empty()) sum_.update(dir_.data(), dir_.size()*4);
+        return (entry_->flags & kBnnUnchecked) || sum_.digest()==entry_->checksum;
+    }
+
+private:
+    const ReadAt&          rd_;
+    ThreadPool*            pool_;
+    CodecLayout            layout_;
+    uint64_t               nElems_{0}, off_{0}, pos_{0};
+    const BnnSectionEntry* entry_{nullptr};
+    Checksum64             sum_;
+    std::vector<uint32_t>  dir_;              /* coded: encoded block sizes */
+    std::vector<uint64_t>  at_;               /* coded: block offsets + end */
+    std::vector<uint64_t>  rel_;
+    std::vector<uint8_t>   buf_;
+};
+
+/* elements [first, first+n) of one synapse array, contiguous; valid
+   until the next call                                                */
+using Fetch = std::function<const uint8_t*(uint64_t first, uint64_t n)>;
+
+/* block-code n elements from src onto os (BnnCodecHeader, blocks, sizes)
+   and return the section size; encoding runs on the pool one group of
+   blocks at a time, the previous group is hashed while it is written */
+static uint64_t write_coded(std::ostream& os, ThreadPool* pool, const CodecLayout& L,
+                            const Fetch& src, uint64_t n, Checksum64& c)
+{
+    const uint64_t nBlocks = (n + kCodecBlock - 1) / kCodecBlock;
+    const BnnCodecHeader h{ kBnnCodec, L.elemBytes, kCodecBlock, uint32_t(nBlocks), n, 0 };
+    os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    c.update(&h, sizeof(h));
+
+    const uint64_t group = std::max<uint64_t>(pool ? pool->size() : 1,
+                                              kIoBytes / (uint64_t(kCodecBlock)*L.elemBytes));
+    uint64_t       bytes = sizeof(h);
+    std::vector<uint32_t>             dir;
+    std::vector<std::vector<uint8_t>> blocks;
+    dir.reserve(nBlocks);
+    for(uint64_t i=0;i<n;i+=group*kCodecBlock){
+        const uint64_t k = std::min(group*kCodecBlock, n-i);
+        codec_encode_blocks(pool, L, src(i, k), k, blocks);
+
+        auto hashing = std::async(std::launch::async, [&c, &blocks]{
+            for(auto& b : blocks) c.update(b.data(), b.size());
+        });
+        for(auto& b : blocks){
+            os.write(reinterpret_cast<const char*>(b.data()), std::streamsize(b.size()));
+            dir.push_back(uint32_t(b.size()));
+            bytes += b.size();
+        }
+        hashing.get();
+    }
+
+    os.write(reinterpret_cast<const char*>(dir.data()), std::streamsize(dir.size()*4));
+    c.update(dir.data(), dir.size()*4);
+    return bytes + dir.size()*4;
+}
+
+/* ===================================================================== */
+/* one section to write: bytes at p, or a writer that streams it, feeds
+   the checksum and returns its size                                   */
+struct OutSection
+{
+    BnnSectionId id;
+    const void*  p;
+    uint64_t     bytes;
+    uint32_t     flags;
+    std::function<uint64_t(std::ostream&, Checksum64&)> write;
+};
+
+/* v3 writer: header + table, then each section on a 64-byte boundary;
+   checksums (and streamed sizes) are taken while writing and the table
+   is patched at the end. Returns the header checksum (the file's id) */
+static uint64_t write_bnn(std::ostream& os, BnnFileHeader h, const std::vector<OutSection>& out)
+{
+    h.nSections = uint32_t(out.size());
+    std::vector<BnnSectionEntry> table(out.size());
+
+    /* ---------- header + table placeholder, then the sections -------- */
+    const std::streamoff base = os.tellp();
+    os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    os.write(reinterpret_cast<const char*>(table.data()), table.size()*sizeof(BnnSectionEntry));
+
+    static const char zeros[kBnnAlign] = {};
+    uint64_t pos = sizeof(h) + table.size()*sizeof(BnnSectionEntry);
+    for(size_t s=0;s<out.size();++s){
+        const uint64_t at = (pos + kBnnAlign-1) & ~uint64_t(kBnnAlign-1);
+        os.write(zeros, std::streamsize(at - pos));
+        table[s] = { uint32_t(out[s].id), out[s].flags, at, out[s].bytes, 0 };
+
+        Checksum64 c;
+        if(out[s].write) table[s].bytes = out[s].write(os, c);
+        else             write_hashed(os, out[s].p, out[s].bytes, c);
+        table[s].checksum = c.digest();
+        pos = at + table[s].bytes;
+    }
+
+    /* ---------- patch the table with the checksums ------------------- */
+    h.checksum = header_checksum(h, table);
+    os.seekp(base);
+    os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    os.write(reinterpret_cast<const char*>(table.data()), table.size()*sizeof(BnnSectionEntry));
+    os.seekp(base + std::streamoff(pos));
+    return h.checksum;
+}
+
+/* header of a file describing this brain; flags add kBnnDelta */
+BnnFileHeader Brain::bnn_header(uint32_t flags) const
+{
+    BnnFileHeader h{};
+    h.magic   = kBnnMagic;  h.version = kBnnVersion;
+    h.flags   = bnn_flags(uint32_t(syn_.layout()), uint32_t(syn_.weight_format())) | flags;
+    h.nSyn    = N_SYN_;     h.nNrn    = N_NRN_;
+    h.nInput  = N_INPUT_;   h.nOutput = N_OUTPUT_;
+    h.wLo     = syn_.weight_lo(); h.wHi = syn_.weight_hi();
+    h.nLive   = nLive_;
+    return h;
+}
+
+/* ===================================================================== */
+/* what the writers stream: the live brain (save) or a frozen snapshot */
+struct BnnImage
+{
+    BnnFileHeader   header;               /* flags: layout + format only */
+    BnnState        st;
+    const uint32_t* lastF;
+    const uint32_t* lastV;
+    const void*     types;                /* E/I only, else null */
+    const uint32_t* lastI;
+    std::function<const uint8_t*(int a, uint64_t first, uint64_t n)> fetch;
+};
+
+static std::vector<OutSection> state_sections(const BnnImage& im)
+{
+    const uint64_t bytes = uint64_t(im.header.nNrn)*4;
+    std::vector<OutSection> out = {
+        { BnnSectionId::State,     &im.st,   sizeof(im.st), 0, nullptr },
+        { BnnSectionId::LastFired, im.lastF, bytes,         0, nullptr },
+        { BnnSectionId::LastVisit, im.lastV, bytes,         0, nullptr } };
+    if(im.types){
+        out.push_back({ BnnSectionId::NeuronTypes, im.types, im.header.nNrn, 0, nullptr });
+        out.push_back({ BnnSectionId::LastInhibit, im.lastI, bytes,          0, nullptr });
+    }
+    return out;
+}
+
+/* full file: every synapse array, raw (kIoBytes writes) or block-coded */
+static uint64_t write_full(std::ostream& os, const BnnImage& im, bool compress, ThreadPool* pool)
+{
+    const SynapseLayout layout = SynapseLayout(bnn_layout(im.header.flags));
+    const WeightFormat  wfmt   = WeightFormat(bnn_weight_format(im.header.flags));
+    const uint64_t      n      = im.header.nSyn;
+    std::vector<OutSection> out;
+
+    for(int a=0;a<n_arrays(layout);++a){
+        const uint64_t eb  = elem_bytes(layout, wfmt, a);
+        const Fetch    src = [&im, a](uint64_t first, uint64_t k){ return im.fetch(a, first, k); };
+        OutSection o{ kSynSection[int(layout)][a], nullptr, n*eb, 0, nullptr };
+        if(compress){
+            o.flags = kBnnCoded;
+            o.write = [pool, src, n, L = codec_layout(layout, wfmt, a)](std::ostream& os, Checksum64& c){
+                return write_coded(os, pool, L, src, n, c);
+            };
+        } else {
+            o.write = [src, n, eb](std::ostream& os, Checksum64& c){
+                const uint64_t step = kIoBytes/eb/kDirtyBlock*kDirtyBlock;
+                for(uint64_t i=0;i<n;i+=step){
+                    const uint64_t k = std::min(step, n-i);
+                    write_hashed(os, src(i, k), k*eb, c);
+                }
+                return n*eb;
+            };
+        }
+        out.push_back(std::move(o));
+    }
+    for(auto& o : state_sections(im)) out.push_back(o);
+    return write_bnn(os, im.header, out);
+}
+
+/* delta: the weights of the given blocks and the state, on top of parent */
+static uint64_t write_delta(std::ostream& os, const BnnImage& im,
+                            const std::vector<uint32_t>& blocks, uint64_t parent)
+{
+    const SynapseLayout layout = SynapseLayout(bnn_layout(im.header.flags));
+    const WeightFormat  wfmt   = WeightFormat(bnn_weight_format(im.header.flags));
+    const uint64_t      n      = im.header.nSyn;
+    const uint32_t      wb     = weight_bytes(wfmt);
+    const int           aw     = n_arrays(layout)-1;          /* array holding w */
+    const BnnDeltaInfo  info{ parent, uint32_t(kDirtyBlock), uint32_t(blocks.size()) };
+
+    uint64_t wBytes = 0;
+    for(uint32_t b : blocks) wBytes += std::min<uint64_t>(kDirtyBlock, n - b*kDirtyBlock)*wb;
+
+    /* weights block by block, staged so the file sees kIoBytes writes */
+    auto weights = [&](std::ostream& os, Checksum64& c){
+        std::vector<uint8_t> stage;
+        stage.reserve(std::min<uint64_t>(wBytes, kIoBytes));
+        for(uint32_t b : blocks){
+            const uint64_t i0 = uint64_t(b)*kDirtyBlock;
+            const uint64_t k  = std::min<uint64_t>(kDirtyBlock, n - i0);
+            const uint8_t* p  = im.fetch(aw, i0, k);
+            const size_t   at = stage.size();
+            stage.resize(at + k*wb);
+            if(layout==SynapseLayout::Packed)
+                for(uint64_t j=0;j<k;++j)
+                    std::memcpy(&stage[at + 4*j], p + j*sizeof(SynapsePacked) + offsetof(SynapsePacked, w), 4);
+            else
+                std::memcpy(&stage[at], p, k*wb);
+            if(stage.size() >= kIoBytes){ write_hashed(os, stage.data(), stage.size(), c); stage.clear(); }
+        }
+        write_hashed(os, stage.data(), stage.size(), c);
+        return wBytes;
+    };
+
+    std::vector<OutSection> out = {
+        { BnnSectionId::DeltaInfo,    &info,         sizeof(info),    0, nullptr },
+        { BnnSectionId::DirtyBlocks,  blocks.data(), blocks.size()*4, 0, nullptr },
+        { BnnSectionId::BlockWeights, nullptr,       wBytes,          0, weights },
+    };
+    for(auto& o : state_sections(im)) out.push_back(o);
+    BnnFileHeader h = im.header;
+    h.flags |= kBnnDelta;
+    return write_bnn(os, h, out);
+}
+
+/* the live brain: arrays are streamed straight from the store */
+BnnImage Brain::live_image() const
+{
+    const SynapseView v = syn_.view();
+    const uint8_t* base[3] = {};
+    if(v.layout==SynapseLayout::Packed) base[0] = reinterpret_cast<const uint8_t*>(v.pk);
+    else { base[0] = reinterpret_cast<const uint8_t*>(v.src);
+           base[1] = reinterpret_cast<const uint8_t*>(v.dst);
+           base[2] = static_cast<const uint8_t*>(syn_.weights()); }
+
+    BnnImage im{ bnn_header(0), { *clock_, *rBar_, *reward_, 0, pass_, key_.k0, key_.k1 },
+                 lastF_, lastV_, typed() ? types_.data() : nullptr, lastI_, nullptr };
+    im.fetch = [layout = v.layout, wfmt = v.wfmt, base0 = base[0], base1 = base[1], base2 = base[2]]
+               (int a, uint64_t first, uint64_t){
+        const uint8_t* b = a==0 ? base0 : a==1 ? base1 : base2;
+        return b + first*elem_bytes(layout, wfmt, a);
+    };
+    return im;
+}
+
+/* ===================================================================== */
+uint64_t Brain::save(std::ostream& os, bool compress) const
+{
+    return write_full(os, live_image(), compress, cpu_ ? &cpu_->pool() : nullptr);
+}
+
+uint64_t Brain::save_delta(std::ostream& os) const
+{
+    assert(delta_ok());
+    std::vector<uint32_t> blocks;
+    for(uint64_t b=0;b<syn_.n_blocks();++b) if(syn_.dirty()[b]) blocks.push_back(uint32_t(b));
+    return write_delta(os, live_image(), blocks, ckptId_);
+}
+
+/* ===================================================================== */
+/* background checkpoint: state copied now, weights frozen in the store */
+bool Brain::begin_snapshot(bool delta)
+{
+    if(!cpu_ || !syn_.tracks_dirty() || syn_.frozen()) return false;
+    if(delta && !delta_ok()) return false;
+
+    if(!snap_) snap_ = std::make_unique<Snapshot>();
+    Snapshot& s = *snap_;
+    s.delta  = delta;
+    s.parent = ckptId_;
+    s.clock  = *clock_; s.rBar = *rBar_; s.reward = *reward_;
+    s.pass   = pass_;   s.key  = key_;
+    s.lastF.assign(lastF_, lastF_ + N_NRN_);
+    s.lastV.assign(lastV_, lastV_ + N_NRN_);
+    s.types = types_;
+    if(typed()) s.lastI.assign(lastI_, lastI_ + N_NRN_);
+    else        s.lastI.clear();
+    s.blocks.clear();
+    if(delta)
+        for(uint64_t b=0;b<syn_.n_blocks();++b) if(syn_.dirty()[b]) s.blocks.push_back(uint32_t(b));
+
+    /* from here on the dirty map collects the next delta; it continues
+       the snapshot's file once that is written (end_snapshot)          */
+    syn_.freeze(delta ? syn_.dirty() : nullptr);
+    mark_checkpoint(0);
+    return true;
+}
+
+uint64_t Brain::write_snapshot(std::ostream& os, bool compress) const
+{
+    assert(syn_.frozen() && snap_);
+    const Snapshot& s = *snap_;
+    std::vector<uint8_t> stage;
+    BnnImage im{ bnn_header(0), { s.clock, s.rBar, s.reward, 0, s.pass, s.key.k0, s.key.k1 },
+                 s.lastF.data(), s.lastV.data(),
+                 s.types.empty() ? nullptr : s.types.data(), s.lastI.data(), nullptr };
+    im.fetch = [this, &stage](int a, uint64_t first, uint64_t n){
+        return syn_.read_frozen(a, first, n, stage);
+    };
+    /* the pool belongs to the passes running meanwhile */
+    return s.delta ? write_delta(os, im, s.blocks, s.parent)
+                   : write_full(os, im, compress, nullptr);
+}
+
+void Brain::end_snapshot(uint64_t id)
+{
+    if(!syn_.frozen()) return;
+    syn_.thaw();
+    ckptId_ = id;
+}
+
+bool Brain::delta_ok() const
+{
+    return ckptId_ && syn_.tracks_dirty() && !syn_.restructured();
+}
+
+double Brain::dirty_fraction() const
+{
+    return syn_.n_blocks() ? double(syn_.count_dirty()) / syn_.n_blocks() : 1.0;
+}
+
+void Brain::mark_checkpoint(uint64_t id)
+{
+    ckptId_ = id;
+    syn_.clear_dirty();
+}
+
+/* ===================================================================== */
+/* file matches this brain's dimensions */
+bool Brain::fits(const BnnInfo& f) const
+{
+    return f.nSyn==N_SYN_ && f.nNrn==N_NRN_
+        && (!f.nInput  || f.nInput ==N_INPUT_)
+        && (!f.nOutput || f.nOutput==N_OUTPUT_);
+}
+
+/* clock, reward baseline, Philox position and the per-neuron timestamps
+   of a v3 file; v1/v2 files carry none and leave the brain cold. The
+   E/I types come with the file: without them the brain is homogeneous
+   (on Metal, which has no E/I kernels, they are ignored)              */
+bool Brain::restore_state(const BnnInfo& f, const ReadAt& rd)
+{
+    const bool typedFile = f.version >= 3 && f.find(BnnSectionId::NeuronTypes) && cpu_;
+    enable_types(typedFile);
+    if(f.version < 3) return true;
+
+    BnnState st;
+    if(!read_section(rd, f.find(BnnSectionId::State), &st, sizeof(st)))                 return false;
+    if(!read_section(rd, f.find(BnnSectionId::LastFired), lastF_, uint64_t(N_NRN_)*4))   return false;
+    if(!read_section(rd, f.find(BnnSectionId::LastVisit), lastV_, uint64_t(N_NRN_)*4))   return false;
+    if(typedFile){
+        if(!read_section(rd, f.find(BnnSectionId::NeuronTypes), types_.data(), N_NRN_))    return false;
+        if(!read_section(rd, f.find(BnnSectionId::LastInhibit), lastI_, uint64_t(N_NRN_)*4)) return false;
+        nInh_ = 0;
+        for(uint32_t n=0;n<N_NRN_;++n){
+            if(types_[n]!=NeuronType::Exc && types_[n]!=NeuronType::Inh) return false;
+            nInh_ += types_[n]==NeuronType::Inh;
+        }
+    }
+
+    *clock_ = st.clock;
+    *rBar_  = st.rBar;
+    set_reward(st.reward);
+    pass_   = st.pass;
+    key_    = { st.key0, st.key1 };
+    return true;
+}
+
+/* live count of the file: a full one (or one from before free slots)
+   needs no scan, otherwise the slots are counted and must agree      */
+bool Brain::restore_slots(const BnnInfo& f)
+{
+    const uint64_t live = f.version>=3 && f.header.nLive ? f.header.nLive : N_SYN_;
+    nLive_ = N_SYN_;
+    free_at_tail();
+    if(live==N_SYN_) return true;
+    scan_free();
+    return nLive_==live;
+}
+
+/* ===================================================================== */
+void Brain::load(std::istream& is)
+{
+    const std::streamoff base = is.tellg();
+    const ReadAt rd = [&](uint64_t off, void* dst, uint64_t n){
+        is.seekg(base + std::streamoff(off));
+        is.read(static_cast<char*>(dst), std::streamsize(n));
+        return bool(is);
+    };
+
+    BnnInfo f;
+    if(!parse_bnn(rd, f) || f.delta) throw new std::exception();
+
+    /* a model grown online: this brain grows to the file's size first */
+    if(!fits(f) && f.nNrn > N_INPUT_ + N_OUTPUT_ && f.nSyn >= N_SYN_ && f.nSyn <= SYN_CAP_)
+        grow_storage(f.nNrn - N_INPUT_ - N_OUTPUT_, f.nSyn);
+    if(!fits(f)) throw new std::exception();
+
+    const int  nA   = n_arrays(f.layout);
+    ThreadPool* pool = cpu_ ? &cpu_->pool() : nullptr;
+    std::vector<SectionReader> rdr(nA, SectionReader(rd, pool));
+    for(int a=0;a<nA;++a) if(!rdr[a].open(f, a)) throw new std::exception();
+
+    /* same layout + format: straight into the store */
+    const bool same = f.layout==syn_.layout() && f.wfmt==syn_.weight_format()
+                   && (syn_.weight_format()!=WeightFormat::U8 ||
+                       (f.wLo==syn_.weight_lo() && f.wHi==syn_.weight_hi()));
+    if(same){
+        const SynapseView v = syn_.view();
+        void* dst[3] = { v.pk, nullptr, nullptr };
+        if(v.layout==SynapseLayout::SoA){ dst[0] = v.src; dst[1] = v.dst; dst[2] = syn_.weights(); }
+        for(int a=0;a<nA;++a)
+            if(!rdr[a].read(dst[a], f.nSyn)) throw new std::exception();
+    } else {
+        SynapseStore               tmp;
+        std::vector<SynapsePacked> buf(std::min<uint64_t>(kIoChunk, N_SYN_));
+        for(uint64_t i=0;i<N_SYN_;i+=kIoChunk){
+            const uint64_t n = std::min<uint64_t>(kIoChunk, N_SYN_-i);
+            if(tmp.size()!=n) tmp.allocate(n, f.layout, f.wfmt, f.wLo, f.wHi);
+
+            const SynapseView t = tmp.view();
+            void* dst[3] = { t.pk, nullptr, nullptr };
+            if(t.layout==SynapseLayout::SoA){ dst[0] = t.src; dst[1] = t.dst; dst[2] = tmp.weights(); }
+            for(int a=0;a<nA;++a)
+                if(!rdr[a].read(dst[a], n)) throw new std::exception();
+            tmp.to_packed(buf.data(), 0, n);
+            syn_.from_packed(buf.data(), i, n);
+        }
+    }
+
+    /* v3: every synapse section must match its checksum */
+    for(int a=0;a<nA;++a)
+        if(!rdr[a].verify()) throw new std::exception();
+    if(!restore_state(f, rd)) throw new std::exception();
+    if(!restore_slots(f)) throw new std::exception();
+
+    /* the store now is the file; a re-sort below counts as a change */
+    mark_checkpoint(f.version>=3 ? f.header.checksum : 0);
+    synapses_modified();
+}
+
+/* ===================================================================== */
+/* delta on top of the current checkpoint: dirty-block weights (converted
+   when the file's layout / format differs from the store), then state.
+   Everything is verified before the store is touched                  */
+void Brain::apply_delta(std::istream& is)
+{
+    const std::streamoff base = is.tellg();
+    const ReadAt rd = [&](uint64_t off, void* dst, uint64_t n){
+        is.seekg(base + std::streamoff(off));
+        is.read(static_cast<char*>(dst), std::streamsize(n));
+        return bool(is);
+    };
+
+    BnnInfo f;
+    if(!parse_bnn(rd, f) || !f.delta || !fits(f)) throw new std::exception();
+
+    BnnDeltaInfo info;
+    if(!read_section(rd, f.find(BnnSectionId::DeltaInfo), &info, sizeof(info))
+       || !ckptId_ || info.parent!=ckptId_ || !info.blockSyn) throw new std::exception();
+
+    std::vector<uint32_t> blocks(info.nBlocks);
+    if(!read_section(rd, f.find(BnnSectionId::DirtyBlocks), blocks.data(), blocks.size()*4))
+        throw new std::exception();
+
+    const uint32_t wb = weight_bytes(f.wfmt);
+    uint64_t wBytes = 0;
+    for(uint32_t k=0;k<blocks.size();++k){
+        const uint64_t i0 = uint64_t(blocks[k])*info.blockSyn;
+        if(i0 >= N_SYN_ || (k && blocks[k]<=blocks[k-1])) throw new std::exception();
+        wBytes += std::min<uint64_t>(info.blockSyn, N_SYN_-i0)*wb;
+    }
+    std::vector<uint8_t> w(wBytes);
+    if(!read_section(rd, f.find(BnnSectionId::BlockWeights), w.data(), wBytes))
+        throw new std::exception();
+    /* nothing is applied unless the whole file checks out */
+    if(!verify_section(rd, f.find(BnnSectionId::State), sizeof(BnnState))
+       || !verify_section(rd, f.find(BnnSectionId::LastFired), uint64_t(N_NRN_)*4)
+       || !verify_section(rd, f.find(BnnSectionId::LastVisit), uint64_t(N_NRN_)*4))
+        throw new std::exception();
+    if(f.find(BnnSectionId::NeuronTypes)
+       && (!verify_section(rd, f.find(BnnSectionId::NeuronTypes), N_NRN_)
+           || !verify_section(rd, f.find(BnnSectionId::LastInhibit), uint64_t(N_NRN_)*4)))
+        throw new std::exception();
+
+    /* ---------- weights into the store ------------------------------- */
+    const SynapseView v    = syn_.view();
+    const bool        same = f.wfmt==v.wfmt && (v.wfmt!=WeightFormat::U8 ||
+                             (f.wLo==syn_.weight_lo() && f.wHi==syn_.weight_hi()));
+    const float       step = (f.wHi - f.wLo)*(1.0f/255.0f);
+    std::vector<SynapsePacked> buf;
+    const uint8_t* p = w.data();
+    for(uint32_t b : blocks){
+        const uint64_t i0 = uint64_t(b)*info.blockSyn;
+        const uint64_t n  = std::min<uint64_t>(info.blockSyn, N_SYN_-i0);
+        if(same && v.layout==SynapseLayout::SoA){
+            std::memcpy(static_cast<uint8_t*>(syn_.weights()) + i0*wb, p, n*wb);
+        } else if(same){
+            for(uint64_t k=0;k<n;++k) std::memcpy(&v.pk[i0+k].w, p + 4*k, 4);
+        } else {
+            buf.resize(n);
+            syn_.to_packed(buf.data(), i0, n);
+            for(uint64_t k=0;k<n;++k){
+                const uint8_t* q = p + k*wb;
+                uint16_t h;
+                switch(f.wfmt){
+                    case WeightFormat::F16:  std::memcpy(&h, q, 2); buf[k].w = decode_f16(h);  break;
+                    case WeightFormat::BF16: std::memcpy(&h, q, 2); buf[k].w = decode_bf16(h); break;
+                    case WeightFormat::U8:   buf[k].w = decode_u8(*q, f.wLo, step);            break;
+                    default:                 std::memcpy(&buf[k].w, q, 4);                     break;
+                }
+            }
+            syn_.from_packed(buf.data(), i0, n);
+        }
+        p += n*wb;
+    }
+
+    if(!restore_state(f, rd)) throw new std::exception();
+    if(!restore_slots(f)) throw new std::exception();
+    mark_checkpoint(f.header.checksum);
+    synapses_modified();
+}
+
+/* ===================================================================== */
+/* zero-copy: synapse sections are used in place and not hashed (that
+   would fault in the whole file); the small state sections are checked */
+bool Brain::load_mapped(const std::string& path, MapMode mode)
+{
+    assert(cpu_ && "Metal buffers are allocated by the device");
+
+    auto file = std::make_unique<MappedFile>();
+    if(!file->open(path, mode)) return false;
+
+    const MappedFile* m = file.get();
+    const ReadAt rd = [m](uint64_t off, void* dst, uint64_t n){
+        if(off > m->size() || n > m->size()-off) return false;
+        std::memcpy(dst, m->data()+off, n);
+        return true;
+    };
+
+    BnnInfo f;
+    if(!parse_bnn(rd, f) || f.delta || !fits(f)) return false;
+    if(f.layout!=syn_.layout() || f.wfmt!=syn_.weight_format() || coded(f)) return false;
+    for(int a=0;a<n_arrays(f.layout);++a)
+        if(f.off[a] + f.nSyn*elem_bytes(f.layout, f.wfmt, a) > m->size()) return false;
+    if(!restore_state(f, rd)) return false;
+
+    syn_.attach_mapped(std::move(file), f.off, N_SYN_, f.layout, f.wfmt, f.wLo, f.wHi);
+    if(!restore_slots(f)){                        /* back to owned arrays */
+        syn_.allocate(N_SYN_, f.layout, f.wfmt, f.wLo, f.wHi);
+        nLive_ = N_SYN_; free_at_tail();
+        return false;
+    }
+    mark_checkpoint(f.version>=3 ? f.header.checksum : 0);
+    synapses_modified();
+    return true;
+}
+
+/* ===================================================================== */
+/* shared mapping of path: the synapses already are the file; a v3 file
+   also gets the current state sections and a fresh header checksum.
+   Synapse checksums cannot follow in-place training without reading
+   everything back, so those sections are marked unchecked             */
+bool Brain::sync_mapped(const std::string& path)
+{
+    MappedFile* m = syn_.mapped();
+    if(!m || m->mode()!=MapMode::Shared || m->path()!=path) return false;
+
+    BnnFileHeader h;
+    std::memcpy(&h, m->data(), std::min<uint64_t>(sizeof(h), m->size()));
+    const bool v3 = m->size() >= sizeof(h) && h.magic==kBnnMagic && h.version==kBnnVersion;
+    if(v3){
+        auto* table = reinterpret_cast<BnnSectionEntry*>(m->data() + sizeof(h));
+        const BnnState st{ *clock_, *rBar_, *reward_, 0, pass_, key_.k0, key_.k1 };
+
+        /* the sections are rewritten in place: E/I must match the file */
+        bool typedFile = false;
+        for(uint32_t s=0;s<h.nSections;++s) typedFile |= table[s].id==uint32_t(BnnSectionId::NeuronTypes);
+        if(typedFile!=typed()) return false;
+
+        for(uint32_t s=0;s<h.nSections;++s){
+            BnnSectionEntry& e = table[s];
+            const void* src = nullptr;
+            switch(BnnSectionId(e.id)){
+                case BnnSectionId::State:     src = &st;    break;
+                case BnnSectionId::LastFired: src = lastF_; break;
+                case BnnSectionId::LastVisit: src = lastV_; break;
+                case BnnSectionId::NeuronTypes: src = types_.data(); break;
+                case BnnSectionId::LastInhibit: src = lastI_;        break;
+                default: e.flags |= kBnnUnchecked; continue;
+            }
+            std::memcpy(m->data() + e.offset, src, e.bytes);
+            e.checksum = Checksum64::of(src, e.bytes);
+        }
+        h.nLive = nLive_;
+        const std::vector<BnnSectionEntry> t(table, table + h.nSections);
+        h.checksum = header_checksum(h, t);
+        std::memcpy(m->data(), &h, sizeof(h));
+    }
+    if(!m->sync()) return false;
+    mark_checkpoint(v3 ? h.checksum : 0);
+    return true;
+}
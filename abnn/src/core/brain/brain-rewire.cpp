@@ -0,0 +1,168 @@
+// brain-rewire.cpp  –  structural plasticity: pruning, synaptogenesis,
+//                      compaction of the synapse slots
+// ======================================================================
+
+#include "brain.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+#include "thread-pool.h"
+
+/* ===================================================================== */
+/* free-slot bookkeeping                                                 */
+void Brain::free_at_tail()
+{
+    end_ = nLive_;
+    blockFree_.assign((uint64_t(N_SYN_) + kDirtyBlock-1) >> kDirtyShift, 0);
+}
+
+/* per block: free slots and the last live one; then end_ is the slot
+   after the last live synapse and the tail beyond it is not counted    */
+void Brain::scan_free()
+{
+    const uint64_t nB = (uint64_t(N_SYN_) + kDirtyBlock-1) >> kDirtyShift;
+    std::vector<uint64_t> lastLive(nB, 0);
+    blockFree_.assign(nB, 0);
+
+    auto scan = [&](uint64_t b0, uint64_t b1, uint32_t){
+        for(uint64_t b=b0;b<b1;++b){
+            const uint64_t i0 = b << kDirtyShift, i1 = std::min<uint64_t>(i0 + kDirtyBlock, N_SYN_);
+            for(uint64_t i=i0;i<i1;++i){
+                if(syn_.is_free(i)) ++blockFree_[b];
+                else                lastLive[b] = i+1;
+            }
+        }
+    };
+    if(cpu_) cpu_->pool().parallel_for(nB, scan);
+    else     scan(0, nB, 0);
+
+    uint64_t nFree = 0;
+    end_ = 0;
+    for(uint64_t b=0;b<nB;++b){ nFree += blockFree_[b]; end_ = std::max(end_, lastLive[b]); }
+    nLive_ = N_SYN_ - nFree;
+
+    /* slots at or past end_ are all free */
+    for(uint64_t b=end_ >> kDirtyShift; b<nB; ++b){
+        const uint64_t i0 = b << kDirtyShift, i1 = std::min<uint64_t>(i0 + kDirtyBlock, N_SYN_);
+        blockFree_[b] -= i1 - std::max(i0, end_);
+    }
+}
+
+/* ===================================================================== */
+/* stable, in place: every shard packs its live synapses to its front in
+   parallel, then the packed runs slide down one after the other        */
+void Brain::compact_synapses()
+{
+    assert(!syn_.frozen() && "snapshot in progress");
+    const uint64_t nB = (end_ + kDirtyBlock-1) >> kDirtyShift;
+
+    struct Run { uint64_t first, live; };
+    std::vector<Run> runs(cpu_ ? cpu_->pool().size() : 1, Run{0, 0});
+    auto pack = [&](uint64_t b0, uint64_t b1, uint32_t w){
+        const uint64_t i0 = b0 << kDirtyShift, i1 = std::min(b1 << kDirtyShift, end_);
+        runs[w] = { i0, i0 < i1 ? syn_.compact(i0, i1-i0) : 0 };
+    };
+    if(cpu_) cpu_->pool().parallel_for(nB, pack);
+    else     pack(0, nB, 0);
+
+    std::sort(runs.begin(), runs.end(), [](const Run& a, const Run& b){ return a.first < b.first; });
+    uint64_t to = 0;
+    for(const Run& r : runs){ syn_.move(to, r.first, r.live); to += r.live; }
+    assert(to==nLive_);
+    syn_.free_range(to, end_-to);
+    syn_.mark_restructured();
+
+    free_at_tail();
+    synapses_modified();
+}
+
+/* ===================================================================== */
+RewireStats Brain::rewire(const RewireParams& p)
+{
+    assert(cpu_ && "structural plasticity runs on the host pool");
+    const auto t0 = std::chrono::steady_clock::now();
+    RewireStats rs;
+    if(syn_.frozen()){ rs.live = nLive_; rs.end = end_; rs.deferred = true; return rs; }
+
+    ThreadPool& pool = cpu_->pool();
+    const uint32_t nW = pool.size();
+
+    /* ---------- 1. prune, one block per task step -------------------- */
+    {
+        std::vector<uint64_t> freed(nW, 0);
+        pool.parallel_for((end_ + kDirtyBlock-1) >> kDirtyShift, [&](uint64_t b0, uint64_t b1, uint32_t w){
+            for(uint64_t b=b0;b<b1;++b){
+                const uint64_t i0 = b << kDirtyShift;
+                const uint64_t k  = syn_.prune(i0, std::min(kDirtyBlock, end_-i0), p.wPrune);
+                blockFree_[b] += uint32_t(k);
+                freed[w]      += k;
+            }
+        });
+        for(uint64_t k : freed) rs.pruned += k;
+        nLive_ -= rs.pruned;
+        while(end_ && syn_.is_free(end_-1)){ --end_; --blockFree_[end_ >> kDirtyShift]; }
+        clip_type_runs();
+    }
+
+    /* ---------- 2. grow: one draw per neuron that fired last pass ---- */
+    /* new synapse n → uniform non-input neuron, in neuron order       */
+    std::vector<std::vector<SynapsePacked>> born(nW);
+    const uint32_t fired = *clock_ - kClockInc;
+    const uint32_t nTgt  = N_NRN_ - N_INPUT_;
+    pool.parallel_for(N_NRN_, [&](uint64_t b, uint64_t e, uint32_t w){
+        born[w].clear();
+        for(uint64_t n=b;n<e;++n){
+            if(lastF_[n]!=fired) continue;
+            const Philox4 r = philox(key_, philox_counter(n, pass_, kStreamRewire));
+            if(philox_u01(r.v[0]) >= p.pNew) continue;
+            born[w].push_back({ uint32_t(n), N_INPUT_ + uint32_t((uint64_t(r.v[1])*nTgt) >> 32),
+                                p.wInit, 0.f });
+        }
+    });
+
+    /* free slots below end_ first (lowest block first), then the tail */
+    if(!types_.empty()){
+        rs.grown = place_typed(born);
+        nLive_  += rs.grown;
+    } else {
+        uint64_t b = 0, i = 0;
+        for(auto& list : born)
+            for(const SynapsePacked& s : list){
+                while(b < blockFree_.size() && (b << kDirtyShift) < end_ && !blockFree_[b]){ ++b; i = 0; }
+                uint64_t slot;
+                if(b < blockFree_.size() && (b << kDirtyShift) < end_){
+                    if(!i) i = b << kDirtyShift;
+                    while(!syn_.is_free(i)) ++i;
+                    slot = i++;
+                    --blockFree_[b];
+                } else if(end_ < N_SYN_){
+                    slot = end_++;
+                } else {
+                    break;                            /* at capacity */
+                }
+                syn_.set(slot, s);
+                ++nLive_; ++rs.grown;
+            }
+    }
+
+    /* ---------- 3. compact once the holes are worth a pass over them - */
+    if(rs.pruned || rs.grown){
+        syn_.mark_restructured();
+        if(end_ - nLive_ > uint64_t(p.compactFrac*double(end_))){
+            compact_synapses();
+            rs.compacted = true;
+        } else if(srcIndex_.empty()){
+            place_numa();                      /* type runs kept in place */
+        } else {
+            synapses_modified();
+        }
+    }
+
+    rs.live    = nLive_;
+    rs.end     = end_;
+    rs.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+    return rs;
+}
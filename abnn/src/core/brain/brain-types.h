@@ -0,0 +1,59 @@
+#pragma once
+/* brain-types.h  –  data shared by Brain and its execution backends
+ * ====================================================================
+ * * SynapsePacked is byte-identical to the struct in brain.metal
+ * * the kernel knobs below mirror the #defines in brain.metal so the
+ *   CPU backend reproduces the GPU pass exactly; keep them in sync
+ */
+
+#include <cstdint>
+
+/* -------- constants shared with kernel -------------------------------- */
+static constexpr uint32_t kTickNS       = 1000;
+static constexpr uint32_t kMaxSpikes    = 2560;        /* exploration budget */
+static constexpr uint32_t kRenormThresh = 4'000'000; /* renorm every 4 M   */
+
+struct SynapsePacked { uint32_t src, dst; float w, pad; };
+
+/* a free (pruned or never used) synapse slot: every kernel skips a
+   src of kFreeSyn before it gathers anything (FREE_SYN in brain.metal) */
+static constexpr uint32_t      kFreeSyn     = 0xFFFFFFFFu;
+static constexpr SynapsePacked kFreeSynapse = { kFreeSyn, kFreeSyn, 0.f, 0.f };
+
+/* -------- brain.metal build-time knobs (CPU mirror) ------------------- */
+static constexpr float    kBaseScale    = 0.8f;     /* BASE_SCALE          */
+static constexpr uint32_t kRefractory   = 2u;       /* REFRACTORY          */
+static constexpr uint32_t kWindowPre    = 5u;       /* WINDOW_PRE          */
+static constexpr uint32_t kClockInc     = 1u;       /* CLOCK_INC           */
+
+static constexpr float    kTargetRateHz = 1000.0f;  /* TARGET_RATE_HZ      */
+static constexpr float    kEtaHome      = 1.0e-6f;  /* ETA_HOME            */
+static constexpr float    kEtaReward    = 1.0e-3f;  /* ETA_REWARD          */
+static constexpr float    kAlphaRBar    = 0.001f;   /* ALPHA_RBAR          */
+
+/* -------- excitatory / inhibitory neurons (CPU backend) --------------- */
+/* a synapse acts by its source's type: an excitatory one can fire its
+   target, an inhibitory one silences it for kInhibit ticks instead     */
+enum class NeuronType : uint8_t { Exc = 0, Inh = 1 };
+
+static constexpr uint32_t kInhibit      = 3u;       /* dst silent after an
+                                                       inhibitory hit   */
+static constexpr float    kInhGain      = 4.0f;     /* inhibitory hit odds
+                                                       × excitatory (g) */
+
+/* synapse slots [first, end) whose sources all have one type; free
+   slots belong to whichever run they sit in                           */
+struct TypeRun { uint64_t first, end; NeuronType type; };
+
+/* -------- per-pass plasticity parameters ------------------------------ */
+struct PlasticityParams { float aLTP, aLTD, wMin, wMax; };
+
+/* -------- structural plasticity (Brain::rewire) ----------------------- */
+struct RewireParams
+{
+    float wPrune;             /* live synapses below this weight are freed */
+    float pNew;               /* per spike of the last pass: new synapse   */
+    float wInit;              /* weight of a new synapse                   */
+    float compactFrac;        /* free share of the visited range that
+                                 triggers compaction                      */
+};
@@ -5,34 +5,49 @@
 
 #include <cassert>
 #include <cstring>
+#include <iostream>
 #include <random>
 #include <cmath>
+#include <algorithm>
 
 #include "constants.h"
 
+#ifndef NSEC_PER_SEC
+#define NSEC_PER_SEC 1000000000ull   /* <dispatch/time.h> on Apple */
+#endif
+
+#if ABNN_METAL
 /* helper: release Metal obj */
 template<typename T> static void rel(T*& p){ if(p){ p->release(); p=nullptr; } }
-
-std::mt19937 rng(std::random_device{}());
-std::uniform_real_distribution<float> uni(0.f,1.f);
+#endif
 
 /* ===================================================================== */
 /* ctor / dtor                                                           */
 Brain::Brain(uint32_t nIn,uint32_t nOut,uint32_t nHid,
-             uint32_t nSyn,uint32_t events)
+             uint32_t nSyn,uint32_t events,
+             uint32_t hidRoom,uint32_t synRoom)
 : N_INPUT_(nIn), N_OUTPUT_(nOut), N_HIDDEN_(nHid),
   N_NRN_(nIn+nOut+nHid), N_SYN_(nSyn), EVENTS_(events),
-  hostSyn_(nSyn)
-{}
+  NRN_CAP_(uint32_t(std::min<uint64_t>(uint64_t(N_NRN_)+hidRoom, kFreeSyn-1))),
+  SYN_CAP_(uint32_t(std::min<uint64_t>(uint64_t(nSyn)+synRoom, UINT32_MAX))),
+  nLive_(nSyn), end_(nSyn)
+{
+    set_seed(RNG_SEED);
+}
 Brain::~Brain(){ release_all(); }
 
 void Brain::release_all()
 {
+#if ABNN_METAL
     rel(bufSyn_); rel(bufLastFire_); rel(bufLastVisit_);
     rel(bufClock_); rel(bufBudget_); rel(bufReward_); rel(bufRBar_);
     rel(pipeTrav_); rel(pipeRenorm_);
+#endif
+    cpu_.reset();
 }
 
+#if ABNN_METAL
+
 /* ===================================================================== */
 /* build Metal pipeline objects                                          */
 void Brain::build_pipeline(MTL::Device* d, MTL::Library* lib)
@@ -66,6 +81,99 @@ void Brain::build_buffers(MTL::Device* d)
     *static_cast<uint32_t*>(bufBudget_->contents()) = kMaxSpikes;
     *static_cast<float*>   (bufReward_->contents()) = 0.0f;
     *static_cast<float*>   (bufRBar_->contents())   = 0.0f;
+
+    syn_.attach_packed(static_cast<SynapsePacked*>(bufSyn_->contents()), N_SYN_);
+    nLive_ = N_SYN_;
+    free_at_tail();
+    lastF_  = static_cast<uint32_t*>(bufLastFire_->contents());
+    lastV_  = static_cast<uint32_t*>(bufLastVisit_->contents());
+    clock_  = static_cast<uint32_t*>(bufClock_->contents());
+    reward_ = static_cast<float*>(bufReward_->contents());
+    rBar_   = static_cast<float*>(bufRBar_->contents());
+}
+#endif
+
+/* ===================================================================== */
+/* allocate & zero host arrays, spin up the worker pool                 */
+void Brain::build_host_buffers(uint32_t nThreads, SynapseLayout layout,
+                               WeightFormat wfmt, HostPages pages)
+{
+    syn_.set_pages(pages);
+    syn_.set_capacity(SYN_CAP_);
+    syn_.allocate(N_SYN_, layout, wfmt, _wMin, _wMax);
+    nLive_ = N_SYN_;
+    free_at_tail();
+    hostLastFire_.allocate(N_NRN_, pages, NRN_CAP_);
+    hostLastVisit_.allocate(N_NRN_, pages, NRN_CAP_);
+    hostClock_ = 0; hostReward_ = 0.0f; hostRBar_ = 0.0f;
+
+    lastF_  = hostLastFire_.data();
+    lastV_  = hostLastVisit_.data();
+    clock_  = &hostClock_;
+    reward_ = &hostReward_;
+    rBar_   = &hostRBar_;
+
+    cpu_ = std::make_unique<CpuTraversal>(nThreads, CPU_SIMD);
+
+    std::cout<<"📄 host pages: synapses "<<host_pages_name(syn_.pages())
+             <<", lastFired "<<host_pages_name(hostLastFire_.pages())
+             <<" ("<<host_pages_name(pages)<<" requested)\n";
+}
+
+void Brain::set_synapse_layout(SynapseLayout layout, WeightFormat wfmt)
+{
+    assert(cpu_ && "Metal buffers are always packed");
+    syn_.convert(layout, wfmt);
+    synapses_modified();
+}
+
+void Brain::set_active_set(bool on)
+{
+    assert(cpu_ && "the Metal kernel indexes synapses by thread id");
+    if(on){ srcIndex_.build(syn_, N_NRN_); free_at_tail(); }
+    else    srcIndex_.clear();
+    index_types();
+    place_numa();
+}
+
+void Brain::set_deterministic(bool on)
+{
+    assert(cpu_ && "the Metal kernel resolves the budget with atomics");
+    cpu_->set_deterministic(on);
+}
+
+void Brain::set_spike_bitmap(bool on)
+{
+    assert(cpu_ && "build_host_buffers() not called");
+    cpu_->set_spike_bitmap(on);
+}
+
+void Brain::set_numa(bool on)
+{
+    assert(cpu_ && "Metal buffers live in unified memory");
+    cpu_->set_numa(on);
+    place_numa();
+}
+
+/* synapse pages follow the dense shards; a re-layout or load allocates
+   fresh arrays, an active-set sort changes the visiting order          */
+void Brain::place_numa()
+{
+    if(!cpu_ || !cpu_->numa()) return;
+    cpu_->place_synapses(syn_.arrays(), std::min<uint64_t>(EVENTS_, end_), N_SYN_, srcIndex_.empty());
+    cpu_->place_shared(lastF_, uint64_t(N_NRN_)*sizeof(uint32_t),
+                       host_page_bytes(hostLastFire_.pages()));
+    cpu_->place_shared(lastV_, uint64_t(N_NRN_)*sizeof(uint32_t),
+                       host_page_bytes(hostLastVisit_.pages()));
+    cpu_->place_shared(lastI_, uint64_t(N_NRN_)*sizeof(uint32_t),
+                       host_page_bytes(hostLastInhibit_.pages()));
+}
+
+/* ===================================================================== */
+void Brain::set_seed(uint64_t seed)
+{
+    if(!seed) seed = (uint64_t(std::random_device{}())<<32) | std::random_device{}();
+    key_ = philox_key(seed);
 }
 
 /* ===================================================================== */
@@ -75,13 +183,146 @@ void Brain::inject_inputs(const std::vector<float>& v, float hz)
     assert(v.size()==N_INPUT_);
     float pTick = hz * kTickNS * NSEC_PER_SEC;
 
-    uint32_t* lf  = static_cast<uint32_t*>(bufLastFire_->contents());
-    uint32_t  now = *static_cast<uint32_t*>(bufClock_->contents());
+    uint32_t* lf  = lastF_;
+    uint32_t  now = *clock_;
+
+    draws_.resize(N_INPUT_);
+    philox_uniform(key_, kStreamInput, pass_, 0, N_INPUT_, draws_.data());
 
     for(uint32_t i=0;i<N_INPUT_;++i)
-        if(uni(rng) < pTick * v[i]) lf[i] = now;
+        if(draws_[i] < pTick * v[i]) lf[i] = now;
 }
 
+/* ===================================================================== */
+/* teacher spikes on the outputs, skipped within one tick of a spike     */
+void Brain::inject_teacher(const std::vector<float>& p)
+{
+    assert(p.size()==N_OUTPUT_);
+
+    uint32_t* lf  = lastF_ + N_INPUT_;
+    uint32_t  now = *clock_;
+
+    draws_.resize(N_OUTPUT_);
+    philox_uniform(key_, kStreamTeacher, pass_, 0, N_OUTPUT_, draws_.data());
+
+    for(uint32_t o=0;o<N_OUTPUT_;++o)
+        if(draws_[o] < p[o] && now - lf[o] > 1) lf[o] = now;
+}
+
+/* ===================================================================== */
+void Brain::set_reward(float r)
+{
+    *reward_ = r;
+#if ABNN_METAL
+    if(bufReward_) bufReward_->didModifyRange(NS::Range(0,sizeof(float)));
+#endif
+}
+
+void Brain::synapses_modified()
+{
+    if(!srcIndex_.empty()){ srcIndex_.build(syn_, N_NRN_); free_at_tail(); }
+    index_types();
+    place_numa();
+#if ABNN_METAL
+    if(bufSyn_) bufSyn_->didModifyRange(NS::Range(0,N_SYN_*sizeof(SynapsePacked)));
+#endif
+}
+
+/* ===================================================================== */
+/* neuron relabelling (both backends: works on the host views)           */
+bool Brain::reorder_neurons(NeuronOrder order)
+{
+    if(order==NeuronOrder::None) return false;
+
+    SourceIndex idx;
+    idx.build(syn_, N_NRN_);
+    auto newId = neuron_order(syn_, idx, N_INPUT_+N_OUTPUT_, order);
+
+    /* E/I: excitatory ids first again, each type in the order's
+       sequence, so the store sorted by source has one run per type    */
+    if(!types_.empty()){
+        const uint32_t h0 = N_INPUT_+N_OUTPUT_;
+        std::vector<uint32_t> seq(N_HIDDEN_);
+        for(uint32_t n=h0;n<N_NRN_;++n) seq[newId[n]-h0] = n;
+        std::stable_partition(seq.begin(), seq.end(),
+                              [&](uint32_t n){ return types_[n]==NeuronType::Exc; });
+        for(uint32_t k=0;k<N_HIDDEN_;++k) newId[seq[k]] = h0 + k;
+    }
+
+    bool moved = false;
+    for(uint32_t n=0;n<N_NRN_ && !moved;++n) moved = newId[n]!=n;
+
+    if(moved){
+        relabel_neurons(syn_, newId);
+        free_at_tail();
+
+        /* per-neuron state follows its neuron */
+        for(uint32_t* a : { lastF_, lastV_, lastI_ }){
+            if(!a) continue;
+            std::vector<uint32_t> old(a, a+N_NRN_);
+            for(uint32_t n=0;n<N_NRN_;++n) a[newId[n]] = old[n];
+        }
+        if(!types_.empty()){
+            const std::vector<NeuronType> old = types_;
+            for(uint32_t n=0;n<N_NRN_;++n) types_[newId[n]] = old[n];
+        }
+    }
+    synapses_modified();
+    return moved;
+}
+
+/* ===================================================================== */
+TraversalState Brain::traversal_state() const
+{
+    const bool ei = !types_.empty();
+    return { syn_.view(), std::min<uint64_t>(EVENTS_, end_),
+             srcIndex_.empty() ? nullptr : srcIndex_.offsets(), lastF_, N_NRN_,
+             clock_, reward_, rBar_, pass_, key_,
+             ei ? types_.data() : nullptr, ei ? typeRuns_.data() : nullptr,
+             uint32_t(typeRuns_.size()), lastI_ };
+}
+
+/* ===================================================================== */
+/* run one traversal on the CPU worker pool                              */
+void Brain::encode_traversal()
+{
+    assert(cpu_ && "build_host_buffers() not called");
+    const TraversalState st = traversal_state();
+
+    /* same decision point as the Metal path: clock before the pass */
+    const bool renorm = *clock_ > kRenormThresh;
+
+    stats_ = cpu_->run(st, { _aLTP, _aLTD, _wMin, _wMax });
+    ++pass_;
+
+    if(renorm) cpu_->renormalise(st);
+}
+
+/* ===================================================================== */
+/* fused multi-pass step: no return to the caller between passes         */
+void Brain::run_passes(uint32_t k, const std::vector<PassFrame>& frames,
+                       float hz, std::vector<uint8_t>& spikes)
+{
+    assert(cpu_ && "build_host_buffers() not called");
+    assert(frames.size()==k || frames.size()==1);
+
+    spikes.resize(uint64_t(k)*N_OUTPUT_);
+    batchStats_ = TraversalStats{};
+
+    for(uint32_t p=0;p<k;++p){
+        const PassFrame& f = frames[frames.size()==1 ? 0 : p];
+        inject_inputs(f.input, hz);
+        if(!f.teach.empty()) inject_teacher(f.teach);
+
+        encode_traversal();
+        read_outputs(spikes.data() + uint64_t(p)*N_OUTPUT_);
+
+        batchStats_ += stats_;
+    }
+}
+
+#if ABNN_METAL
+
 /* ===================================================================== */
 /* encode one traversal                                                  */
 void Brain::encode_traversal(MTL::CommandBuffer* cb)
@@ -97,7 +338,8 @@ void Brain::encode_traversal(MTL::CommandBuffer* cb)
     enc->setBuffer(bufLastFire_,  0, 1);
     enc->setBuffer(bufLastVisit_, 0, 2);
     enc->setBuffer(bufClock_,     0, 3);
-    enc->setBytes (&N_SYN_, sizeof(uint32_t), 4);
+    const uint32_t nSyn = uint32_t(end_);       /* free tail never dispatched */
+    enc->setBytes (&nSyn, sizeof(uint32_t), 4);
 
     uint32_t tauVis=50'000, tauPre=50'000;
     enc->setBytes(&tauVis,sizeof(uint32_t),5);
@@ -113,8 +355,14 @@ void Brain::encode_traversal(MTL::CommandBuffer* cb)
     enc->setBuffer(bufReward_, 0, 12);
     enc->setBuffer(bufRBar_,   0, 13);
 
+    const uint32_t pass[2] = { uint32_t(pass_), uint32_t(pass_>>32) };
+    enc->setBytes(pass,  sizeof(pass),  14);
+    enc->setBytes(&key_, sizeof(key_),  15);
+    ++pass_;
+
     const uint tg=256;
-    enc->dispatchThreads(MTL::Size(((EVENTS_+tg-1)/tg)*tg,1,1),
+    const uint64_t nT = std::max<uint64_t>(std::min<uint64_t>(EVENTS_, end_), 1);
+    enc->dispatchThreads(MTL::Size(((nT+tg-1)/tg)*tg,1,1),
                          MTL::Size(tg,1,1));
     enc->endEncoding();
 
@@ -139,40 +387,25 @@ void Brain::renormalise_if_needed(MTL::CommandBuffer* cb)
                          MTL::Size(tg,1,1));
     enc->endEncoding();
 }
+#endif
 
 /* ===================================================================== */
 /* read output spikes (bool vector)                                      */
 std::vector<bool> Brain::read_outputs() const
 {
-    std::vector<bool> out(N_OUTPUT_,false);
-    const uint32_t* lf = static_cast<const uint32_t*>(bufLastFire_->contents());
-    uint32_t now = *static_cast<const uint32_t*>(bufClock_->contents());
+    std::vector<uint8_t> spk(N_OUTPUT_);
+    read_outputs(spk.data());
+    return std::vector<bool>(spk.begin(), spk.end());
+}
+
+void Brain::read_outputs(uint8_t* out) const
+{
+    const uint32_t* lf = lastF_;
+    uint32_t now = *clock_;
 
     uint32_t start=now>1? now-1:0;
     for(uint32_t o=0;o<N_OUTPUT_;++o){
         uint32_t ts=lf[N_INPUT_+o];
-        if(ts!=0 && ts>=start && ts<now) out[o]=true;
+        out[o] = ts!=0 && ts>=start && ts<now;
     }
-    return out;
-}
-
-/* ===================================================================== */
-/* persistence                                                           */
-void Brain::save(std::ostream& os) const
-{
-    os.write(reinterpret_cast<const char*>(&N_SYN_), sizeof(uint32_t));
-    os.write(reinterpret_cast<const char*>(&N_NRN_), sizeof(uint32_t));
-    os.write(reinterpret_cast<const char*>(bufSyn_->contents()),
-             N_SYN_*sizeof(SynapsePacked));
-}
-
-void Brain::load(std::istream& is)
-{
-    uint32_t s{},n{};
-    is.read(reinterpret_cast<char*>(&s),4);
-    is.read(reinterpret_cast<char*>(&n),4);
-    if (!(s==N_SYN_ && n==N_NRN_)) throw new std::exception();
-    is.read(reinterpret_cast<char*>(bufSyn_->contents()),
-            N_SYN_*sizeof(SynapsePacked));
-    bufSyn_->didModifyRange(NS::Range(0,N_SYN_*sizeof(SynapsePacked)));
 }
@@ -1,48 +1,222 @@
 #pragma once
 /* brain.h  –  Host-side ABNN representation
  * ====================================================================
- * * Owns all Metal buffers and pipelines
- * * encode_traversal() enqueues one Monte-Carlo pass
- * * Exposes reward_buffer() and last_fired_buffer() for
+ * * Owns all Metal buffers and pipelines (Metal backend) or the host
+ *   arrays and worker pool (CPU backend)
+ * * encode_traversal() enqueues / runs one Monte-Carlo pass
+ * * Exposes last_fired() and set_reward() for
  *   teacher-forcing / reward-modulated STDP.
+ * * Every random draw (synapses, input spikes, teacher forcing) is a
+ *   Philox number keyed by the seed and the pass counter
  */
 
-#include <Metal/Metal.hpp>
+#include "platform.h"
 #include <vector>
+#include <memory>
 #include <cstdint>
+#include <functional>
 #include <istream>
 #include <ostream>
+#include <string>
+#include "brain-types.h"
+#include "synapse-store.h"
+#include "source-index.h"
+#include "neuron-order.h"
+#include "cpu-traversal.h"
 
-/* -------- constants shared with kernel -------------------------------- */
-static constexpr uint32_t kTickNS       = 1000;
-static constexpr uint32_t kMaxSpikes    = 2560;        /* exploration budget */
-static constexpr uint32_t kRenormThresh = 4'000'000; /* renorm every 4 M   */
+/* .bnn reading (brain-io.cpp): parsed file + positional reader ------- */
+struct BnnInfo;
+struct BnnFileHeader;
+struct BnnImage;
+using BnnReadAt = std::function<bool(uint64_t off, void* dst, uint64_t n)>;
 
-struct SynapsePacked { uint32_t src, dst; float w, pad; };
+/* one pass worth of stimulus for Brain::run_passes() ------------------ */
+struct PassFrame
+{
+    std::vector<float> input;           /* N_INPUT rates for inject_inputs */
+    std::vector<float> teach;           /* N_OUTPUT teacher p, empty → none */
+};
+
+/* what one Brain::rewire() did ---------------------------------------- */
+struct RewireStats
+{
+    uint64_t pruned{0}, grown{0};
+    uint64_t live{0}, end{0};           /* n_live() / syn_end() after    */
+    bool     compacted{false};
+    bool     deferred{false};           /* snapshot open: nothing done   */
+    double   seconds{0.0};
+};
+
+/* what one Brain::grow_neurons() did; neurons 0 → nothing changed,
+   deferred says it was a snapshot in progress rather than the room   */
+struct GrowStats
+{
+    uint32_t neurons {0};
+    uint64_t synapses{0};
+    bool     deferred{false};
+    double   seconds {0.0};
+};
 
 /* ===================================================================== */
 class Brain
 {
 public:
+    /* hiddenRoom / synRoom: hidden neurons and synapse slots the CPU
+       arrays reserve address space for beyond the initial size, for
+       grow_neurons() and loading a grown model (0 → fixed size)       */
     Brain(uint32_t nInput,
           uint32_t nOutput,
           uint32_t nHidden,
           uint32_t nSynapses,
-          uint32_t eventsPerPass);
+          uint32_t eventsPerPass,
+          uint32_t hiddenRoom = 0,
+          uint32_t synRoom    = 0);
     ~Brain();
 
-    /* one-time initialisation */
+#if ABNN_METAL
+    /* one-time initialisation (Metal backend) */
     void build_pipeline(MTL::Device*, MTL::Library*);
     void build_buffers (MTL::Device*);
 
-    /* per-pass operations */
+    /* per-pass operations (Metal backend) */
     void encode_traversal(MTL::CommandBuffer*);
+#endif
+
+    /* one-time initialisation (CPU backend), nThreads 0 → all cores;
+       pages is the page size asked for the synapse and timestamp
+       arrays (falls back to smaller pages, see host-array.h)        */
+    void build_host_buffers(uint32_t nThreads = 0,
+                            SynapseLayout layout = SynapseLayout::Packed,
+                            WeightFormat  wfmt   = WeightFormat::F32,
+                            HostPages     pages  = HostPages::Base);
+
+    /* packed ⇄ SoA / weight-format switch (CPU backend only) */
+    void set_synapse_layout(SynapseLayout layout,
+                            WeightFormat  wfmt = WeightFormat::F32);
+
+    /* event-driven passes over a CSR-by-src synapse order (CPU backend
+       only); enabling sorts the synapses, so indices change            */
+    void set_active_set(bool on);
+    bool active_set() const { return !srcIndex_.empty(); }
+
+    /* results independent of the thread count (CPU backend only);
+       spikes of a pass gate from the next pass on                      */
+    void set_deterministic(bool on);
+
+    /* 1-bit "fired within WINDOW_PRE" prefilter (CPU backend only) */
+    void set_spike_bitmap(bool on);
+
+    /* pin workers to NUMA nodes and place synapse shards on their
+       workers' nodes (CPU backend only); kept across re-layouts     */
+    void set_numa(bool on);
+
+    /* per-pass operations (CPU backend, synchronous) */
+    void encode_traversal();
+    const TraversalStats& last_pass_stats() const { return stats_; }
+
+    /* k passes back to back (CPU backend): pass p injects frames[p]
+       (or frames[0] when only one is given), traverses and stores its
+       output spikes in spikes[p*N_OUTPUT + o]; batch_stats() sums the
+       k passes                                                        */
+    void run_passes(uint32_t k, const std::vector<PassFrame>& frames,
+                    float hz, std::vector<uint8_t>& spikes);
+    const TraversalStats& batch_stats() const { return batchStats_; }
+
+    /* per-pass operations (both backends) */
     void inject_inputs(const std::vector<float>& vals, float hz);
+    void inject_teacher(const std::vector<float>& pSpike);  /* per output */
     std::vector<bool> read_outputs() const;
+    void              read_outputs(uint8_t* out) const;   /* N_OUTPUT */
+
+    /* structural plasticity (CPU backend, between passes). n_syn() is
+       a capacity: pruning turns a synapse into a free slot in place
+       (src kFreeSyn, skipped by every kernel) and synaptogenesis fills
+       free slots, lowest first, then the unused tail. Passes visit
+       [0, syn_end()); once free slots make up more than compactFrac
+       of that range, compact_synapses() moves the live synapses to the
+       front in order, so pass cost follows n_live(). Nothing happens
+       while a snapshot is open (the writer reads the store): the call
+       returns deferred and should be repeated after end_snapshot()   */
+    RewireStats rewire(const RewireParams&);
+    void        compact_synapses();
+    uint64_t    n_live()  const { return nLive_; }
+    uint64_t    syn_end() const { return end_;   }
+
+    /* online growth (CPU backend, between passes): n hidden neurons are
+       appended after the last id with 2·n·degree synapses of weight
+       wInit: degree out of each new neuron to uniform hidden ones and
+       n·degree in, spread evenly over the existing hidden neurons as
+       sources, to uniform new ones (see brain-grow.cpp). The arrays
+       grow in place into the room reserved at construction, so the
+       kernels keep indexing flat arrays; a pass budget that covered
+       every slot grows with them. neurons 0 → no room (or Metal, a
+       mapped store); deferred → a snapshot is in progress, call again
+       after end_snapshot()                                            */
+    GrowStats grow_neurons(uint32_t n, uint32_t degree, float wInit);
+
+    /* excitatory / inhibitory neurons (CPU backend, brain-ei.cpp).
+       set_inhibitory() types the top ⌊frac·n_hidden()⌉ hidden ids
+       inhibitory (0 → one homogeneous type again); build the graph
+       after it with n_inhibitory() in the GraphShape. type_runs() cuts
+       the visited slots into runs of one source type, which the pass
+       hands to per-type kernels. Everything that writes synapses keeps
+       the runs few: graph builders, growth and synaptogenesis write in
+       type order and reorder_neurons() keeps inhibitory ids last. The
+       types travel in the .bnn; a file without them loads homogeneous */
+    void     set_inhibitory(float frac);
+    uint32_t n_inhibitory() const { return nInh_; }
+    bool     typed()        const { return !types_.empty(); }
+    const std::vector<TypeRun>& type_runs() const { return typeRuns_; }
+
+    /* relabel hidden neurons for locality and sort synapses to match;
+       inputs/outputs keep their ids. false → order already in place */
+    bool reorder_neurons(NeuronOrder order);
 
-    /* persistence */
-    void save(std::ostream&) const;
-    void load(std::istream&);
+    /* persistence: save() writes a v3 .bnn (synapses, clock, reward
+       baseline, Philox position, lastFired / lastVisit, E/I types and
+       lastInhibit, checksums),
+       with compress the synapse sections go through the block codec
+       (bnn-codec.h, parallel on the CPU pool), and returns the file's
+       id (its header checksum); load() reads v1-v3, grows into the
+       reserved room for a model grown online and throws on any other
+       size mismatch or a failed checksum                             */
+    uint64_t save(std::ostream&, bool compress = false) const;
+    void     load(std::istream&);
+
+    /* incremental checkpoints (CPU backend): the store tracks which
+       kDirtyBlock weight blocks changed since the checkpoint it was
+       loaded from or marked with. save_delta() writes just those
+       blocks plus the state, on top of checkpoint_id(); apply_delta()
+       reads one on top of it and throws when it names another parent.
+       delta_ok() → there is a checkpoint and no synapse has moved
+       since (a sort, reorder or re-layout needs a full save)         */
+    uint64_t save_delta(std::ostream&) const;
+    void     apply_delta(std::istream&);
+    bool     delta_ok() const;
+    double   dirty_fraction() const;              /* of all blocks */
+    uint64_t checkpoint_id() const { return ckptId_; }  /* 0 → none */
+    void     mark_checkpoint(uint64_t id);        /* store == file id */
+
+    /* background checkpoint (CPU backend). begin_snapshot() runs
+       between passes: it copies the state and freezes the weights
+       copy-on-write (SynapseStore::freeze), a delta only its dirty
+       blocks. write_snapshot() then writes that image – as save() or
+       save_delta() would have at begin – from any thread while passes
+       go on, without the worker pool. end_snapshot(), again between
+       passes, drops the frozen copy; id is the written file, 0 → the
+       write failed and the next save must be full. false from begin →
+       Metal, a snapshot still open, or a delta without delta_ok()     */
+    bool     begin_snapshot(bool delta);
+    uint64_t write_snapshot(std::ostream&, bool compress = false) const;
+    void     end_snapshot(uint64_t id);
+
+    /* zero-copy load (CPU backend): map the file and use its payload as
+       the synapse store; pages fault in on first touch. false → the
+       file cannot be used as-is (size, layout or format differ from
+       this build, or it is compressed), fall back to load()        */
+    bool load_mapped(const std::string& path, MapMode mode);
+    /* Shared mapping of path → write-back instead of a rewrite      */
+    bool sync_mapped(const std::string& path);
 
     /* getters ----------------------------------------------------------- */
     uint32_t n_input () const { return N_INPUT_;  }
@@ -51,19 +225,114 @@ public:
     uint32_t n_neuron() const { return N_NRN_;    }
     uint32_t n_syn   () const { return N_SYN_;    }
 
+    bool cpu_backend() const { return cpu_ != nullptr; }
+
+    /* RNG: seed 0 → std::random_device */
+    void      set_seed(uint64_t seed);
+    PhiloxKey key()  const { return key_;  }
+    uint64_t  pass() const { return pass_; }
+
+    /* CPU worker pool for bulk host work; nullptr on Metal */
+    ThreadPool* worker_pool() const { return cpu_ ? &cpu_->pool() : nullptr; }
+
+    /* host views (valid for both backends after build_*buffers) */
+    SynapseStore&       synapses()         { return syn_;    }
+    const SynapseStore& synapses()   const { return syn_;    }
+    uint32_t*           last_fired() const { return lastF_;  }
+    uint32_t            now()        const { return *clock_; }
+
+    void set_reward(float r);
+    void synapses_modified();           /* flush host writes to device /
+                                           re-sort for the active set  */
+
+#if ABNN_METAL
     MTL::Buffer* synapse_buffer()     const { return bufSyn_;       }
     MTL::Buffer* last_fired_buffer()  const { return bufLastFire_;  }
     MTL::Buffer* clock_buffer()       const { return bufClock_;     }
     MTL::Buffer* reward_buffer()      const { return bufReward_;    }
     MTL::Buffer* budget_buffer()      const { return bufBudget_;    }
+#endif
 
 private:
     void release_all();
-    void renormalise_if_needed(MTL::CommandBuffer*);
+    void place_numa();
+    bool fits(const BnnInfo&) const;
+    BnnFileHeader bnn_header(uint32_t flags) const;
+    BnnImage      live_image() const;
+    bool restore_state(const BnnInfo&, const BnnReadAt&);
+    bool restore_slots(const BnnInfo&);
+    TraversalState traversal_state() const;
+
+    /* free-slot bookkeeping from the store (after a load), or after a
+       sort by src, which leaves every free slot behind the live ones */
+    void scan_free();
+    void free_at_tail();
 
-    /* immutable sizes */
-    const uint32_t N_INPUT_, N_OUTPUT_, N_HIDDEN_;
-    const uint32_t N_NRN_,   N_SYN_,    EVENTS_;
+    /* extend the neuron arrays and the store to nHidden / nSyn in place;
+       new neurons have never fired, new slots are zero (caller fills) */
+    bool grow_storage(uint32_t nHidden, uint32_t nSyn);
+
+    /* E/I bookkeeping: types + lastInhibit on (all excitatory, never
+       hit) or dropped; type runs from scratch (rows when sorted by
+       source), for slots [first, end) behind the current runs, or cut
+       back to end_; new synapses placed inside runs of their type      */
+    void enable_types(bool on);
+    void index_types();
+    void append_type_runs(uint64_t first, uint64_t end);
+    void clip_type_runs();
+    uint64_t place_typed(const std::vector<std::vector<SynapsePacked>>& born);
+
+    /* sizes: inputs / outputs are fixed, hidden neurons and synapse
+       slots grow (grow_storage) up to the reserved capacity           */
+    const uint32_t N_INPUT_, N_OUTPUT_;
+    uint32_t       N_HIDDEN_, N_NRN_, N_SYN_, EVENTS_;
+    const uint32_t NRN_CAP_,  SYN_CAP_;
+
+    /* Philox key + counter */
+    PhiloxKey          key_{};
+    uint64_t           pass_{0};
+    uint64_t           ckptId_{0};      /* file the store matches, 0 → none */
+
+    /* slot use: live synapses, end of the visited range and free slots
+       below it per kDirtyBlock (structural plasticity)                 */
+    uint64_t              nLive_{0}, end_{0};
+    std::vector<uint32_t> blockFree_;
+
+    /* E/I: per-neuron types (empty → homogeneous), their inhibitory
+       count and the runs of [0, end_) by source type                   */
+    std::vector<NeuronType> types_;
+    uint32_t                nInh_{0};
+    std::vector<TypeRun>    typeRuns_;
+
+    /* state of an open snapshot (begin_snapshot); kept for its buffers */
+    struct Snapshot
+    {
+        bool                  delta{false};
+        uint64_t              parent{0};
+        uint32_t              clock{0};
+        float                 rBar{0.f}, reward{0.f};
+        uint64_t              pass{0};
+        PhiloxKey             key{};
+        std::vector<uint32_t> lastF, lastV, lastI;
+        std::vector<NeuronType> types;
+        std::vector<uint32_t> blocks;     /* delta: dirty blocks */
+    };
+    std::unique_ptr<Snapshot> snap_;
+    std::vector<float> draws_;          /* batch scratch for inject_* */
+
+    /* synapses: owned (CPU) or attached to bufSyn_ (Metal) */
+    SynapseStore   syn_;
+
+    /* host views into whichever storage is active */
+    uint32_t*      lastF_ {nullptr};
+    uint32_t*      lastV_ {nullptr};
+    uint32_t*      lastI_ {nullptr};      /* E/I only */
+    uint32_t*      clock_ {nullptr};
+    float*         reward_{nullptr};
+    float*         rBar_  {nullptr};
+
+#if ABNN_METAL
+    void renormalise_if_needed(MTL::CommandBuffer*);
 
     /* Metal buffers */
     MTL::Buffer *bufSyn_       {nullptr};
@@ -77,7 +346,15 @@ private:
     /* pipelines */
     MTL::ComputePipelineState *pipeTrav_{nullptr};
     MTL::ComputePipelineState *pipeRenorm_{nullptr};
+#endif
 
-    /* host copy for inspection/debug */
-    std::vector<SynapsePacked> hostSyn_;
+    /* CPU backend storage + workers */
+    HostArray<uint32_t>           hostLastFire_, hostLastVisit_, hostLastInhibit_;
+    uint32_t                      hostClock_ {0};
+    float                         hostReward_{0.0f};
+    float                         hostRBar_  {0.0f};
+    SourceIndex                   srcIndex_;
+    std::unique_ptr<CpuTraversal> cpu_;
+    TraversalStats                stats_;
+    TraversalStats                batchStats_;
 };
@@ -0,0 +1,84 @@
+// checksum.cpp  –  XXH64, streaming
+// ======================================================================
+
+#include "checksum.h"
+
+#include <cstring>
+
+static constexpr uint64_t P1 = 11400714785074694791ull;
+static constexpr uint64_t P2 = 14029467366897019727ull;
+static constexpr uint64_t P3 =  1609587929392839161ull;
+static constexpr uint64_t P4 =  9650029242287828579ull;
+static constexpr uint64_t P5 =  2870177450012600261ull;
+
+static inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+static inline uint64_t rd64(const uint8_t* p)  { uint64_t v; std::memcpy(&v, p, 8); return v; }
+static inline uint32_t rd32(const uint8_t* p)  { uint32_t v; std::memcpy(&v, p, 4); return v; }
+
+static inline uint64_t round64(uint64_t acc, uint64_t in)
+{
+    acc += in * P2;
+    return rotl(acc, 31) * P1;
+}
+
+static inline uint64_t merge(uint64_t h, uint64_t v)
+{
+    h ^= round64(0, v);
+    return h * P1 + P4;
+}
+
+/* ===================================================================== */
+Checksum64::Checksum64()
+: v_{ P1 + P2, P2, 0, 0 - P1 }
+{}
+
+void Checksum64::update(const void* data, uint64_t n)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    total_ += n;
+
+    /* top up a partial stripe first */
+    if(bufN_){
+        const uint32_t k = uint32_t(n < 32 - bufN_ ? n : 32 - bufN_);
+        std::memcpy(buf_ + bufN_, p, k);
+        bufN_ += k; p += k; n -= k;
+        if(bufN_ < 32) return;
+        for(int l=0;l<4;++l) v_[l] = round64(v_[l], rd64(buf_ + 8*l));
+        bufN_ = 0;
+    }
+
+    uint64_t a = v_[0], b = v_[1], c = v_[2], d = v_[3];
+    for(; n >= 32; p += 32, n -= 32){
+        a = round64(a, rd64(p));
+        b = round64(b, rd64(p + 8));
+        c = round64(c, rd64(p + 16));
+        d = round64(d, rd64(p + 24));
+    }
+    v_[0] = a; v_[1] = b; v_[2] = c; v_[3] = d;
+
+    std::memcpy(buf_, p, n);
+    bufN_ = uint32_t(n);
+}
+
+uint64_t Checksum64::digest() const
+{
+    uint64_t h;
+    if(total_ >= 32){
+        h = rotl(v_[0], 1) + rotl(v_[1], 7) + rotl(v_[2], 12) + rotl(v_[3], 18);
+        for(int l=0;l<4;++l) h = merge(h, v_[l]);
+    } else {
+        h = P5;
+    }
+    h += total_;
+
+    const uint8_t* p = buf_;
+    uint32_t       n = bufN_;
+    for(; n >= 8; p += 8, n -= 8){ h ^= round64(0, rd64(p)); h = rotl(h, 27) * P1 + P4; }
+    if(n >= 4){ h ^= uint64_t(rd32(p)) * P1; h = rotl(h, 23) * P2 + P3; p += 4; n -= 4; }
+    for(; n; ++p, --n){ h ^= *p * P5; h = rotl(h, 11) * P1; }
+
+    h ^= h >> 33; h *= P2;
+    h ^= h >> 29; h *= P3;
+    h ^= h >> 32;
+    return h;
+}
@@ -0,0 +1,251 @@
+// graph-builder.cpp  –  parallel, reproducible synapse graphs
+// ======================================================================
+
+#include "graph-builder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "thread-pool.h"
+#include "weight-codec.h"
+
+static constexpr uint64_t kGraphBatch = 1u<<12;     /* synapses per philox_fill */
+
+/* x·n >> 32: uniform in [0, n) without a division (bias < n / 2^32) */
+static inline uint32_t scale(uint32_t x, uint32_t n) { return uint32_t((uint64_t(x)*n) >> 32); }
+
+static inline void put(const SynapseView& v, SynapseStore& store, uint64_t i, const SynapsePacked& s)
+{
+    if(v.layout==SynapseLayout::Packed){ v.pk[i] = s; return; }
+    v.src[i] = s.src; v.dst[i] = s.dst;
+    store.set_weight(i, s.w, kRoundNearest);
+}
+
+const char* topology_name(Topology t)
+{
+    switch(t){
+        case Topology::SmallWorld: return "small-world";
+        case Topology::ScaleFree:  return "scale-free";
+        case Topology::Distance2D: return "distance 2-D";
+        case Topology::Distance3D: return "distance 3-D";
+        default:                   return "random";
+    }
+}
+
+/* ===================================================================== */
+/* row topologies                                                        */
+/* ===================================================================== */
+namespace {
+
+/* Watts–Strogatz: slot j → ±(j/2+1) around h, rewired with beta to a
+   uniform id other than h; the distance wraps before reaching h too  */
+class SmallWorldRows final : public RowGenerator
+{
+public:
+    SmallWorldRows(uint32_t n, float beta)
+    : n_(n), m_(n > 1 ? n-1 : 1), beta_(uint32_t(std::clamp(beta, 0.f, 1.f)*4294967295.0)) {}
+
+    void row(uint32_t h, uint32_t deg, const uint32_t* x, uint32_t* dst) const override
+    {
+        for(uint32_t j=0;j<deg;++j){
+            const uint32_t d = (j/2) % m_ + 1;
+            uint32_t t = j&1 ? (h >= d ? h - d : h + n_ - d) : (h + d < n_ ? h + d : h + d - n_);
+            if(x[4*j+3] < beta_){
+                t  = scale(x[4*j], m_);
+                t += n_ > 1 && t >= h;
+            }
+            dst[j] = t;
+        }
+    }
+
+private:
+    uint32_t n_, m_, beta_;                         /* m_: ids other than h */
+};
+
+/* Barabási–Albert, mean-field: P(i) ∝ i^(-1/2) over the older ids [0, h);
+   the first neuron has no elders and draws from the others [1, n)    */
+class ScaleFreeRows final : public RowGenerator
+{
+public:
+    explicit ScaleFreeRows(uint32_t n) : n_(n) {}
+
+    void row(uint32_t h, uint32_t deg, const uint32_t* x, uint32_t* dst) const override
+    {
+        const uint32_t base = h ? 0 : 1;
+        const uint32_t span = h ? h : n_-1;
+        for(uint32_t j=0;j<deg;++j){
+            const float u = philox_u01(x[4*j]);
+            dst[j] = span ? base + std::min(uint32_t(float(span)*u*u), span-1) : 0;
+        }
+    }
+
+private:
+    uint32_t n_;
+};
+
+/* row-major torus grid of side^dims cells; ids past n fold back. Each
+   axis offset is one 16-bit draw through a table of round(sigma·Φ⁻¹(u)).
+   A draw that lands on h is redrawn once from the spare 16-bit words,
+   and if that lands on h too the target steps to the next id          */
+class DistanceRows final : public RowGenerator
+{
+public:
+    DistanceRows(uint32_t n, uint32_t dims, float sigma)
+    : n_(n), dims_(dims), off_(1u<<16)
+    {
+        side_ = uint32_t(std::ceil(std::pow(double(n), 1.0/dims)));
+        while(side_ > 1 && std::pow(double(side_-1), double(dims)) >= n) --side_;
+
+        /* quantile u → smallest k with Φ((k+½)/sigma) ≥ u */
+        const double s = std::max(double(sigma), 1e-6)*std::sqrt(2.0);
+        int32_t k = -int32_t(std::ceil(8.0*s)) - 1;
+        for(uint32_t u=0;u<off_.size();++u){
+            const double p = (u + 0.5)/double(off_.size());
+            while(0.5*std::erfc(-(k + 0.5)/s) < p) ++k;
+            off_[u] = k;
+        }
+    }
+
+    void row(uint32_t h, uint32_t deg, const uint32_t* x, uint32_t* dst) const override
+    {
+        const int64_t side = side_;
+        const int64_t c[3] = { h % side, (h / side) % side, h / (side*side) };
+        auto target = [&](const uint32_t* w){
+            uint64_t id = 0, stride = 1;
+            for(uint32_t a=0;a<dims_;++a){
+                int64_t p = c[a] + off_[w[a]];
+                if(p < 0 || p >= side) p = (p % side + side) % side;
+                id += uint64_t(p)*stride;
+                stride *= side_;
+            }
+            return uint32_t(id < n_ ? id : id % n_);
+        };
+        for(uint32_t j=0;j<deg;++j){
+            const uint32_t w[3] = { x[4*j]   & 0xFFFFu, x[4*j]   >> 16, x[4*j+1] & 0xFFFFu };
+            const uint32_t r[3] = { x[4*j+3] & 0xFFFFu, x[4*j+3] >> 16, x[4*j+1] >> 16     };
+            uint32_t t = target(w);
+            if(t == h) t = target(r);
+            if(t == h && n_ > 1) t = h+1 < n_ ? h+1 : 0;
+            dst[j] = t;
+        }
+    }
+
+private:
+    uint32_t n_, dims_, side_;
+    std::vector<int32_t> off_;
+};
+
+} // namespace
+
+std::unique_ptr<RowGenerator> make_row_generator(Topology t, uint32_t nHidden,
+                                                 const TopologyParams& p)
+{
+    switch(t){
+        case Topology::SmallWorld: return std::make_unique<SmallWorldRows>(nHidden, p.beta);
+        case Topology::ScaleFree:  return std::make_unique<ScaleFreeRows>(nHidden);
+        case Topology::Distance2D: return std::make_unique<DistanceRows>(nHidden, 2, p.sigma);
+        case Topology::Distance3D: return std::make_unique<DistanceRows>(nHidden, 3, p.sigma);
+        default:                   return nullptr;
+    }
+}
+
+/* ===================================================================== */
+void build_random_graph(SynapseStore& store, const GraphShape& shape,
+                        PhiloxKey key, ThreadPool* pool,
+                        WeightRange in, WeightRange hidden)
+{
+    const SynapseView v   = store.view();
+    const uint64_t    n   = store.size();
+    const uint64_t    nIO = std::min<uint64_t>(uint64_t(shape.nInput)*shape.nOutput, n);
+    const uint32_t    h0  = shape.nInput + shape.nOutput;
+    const uint32_t    nH  = shape.nNeuron - h0;
+    const uint32_t    nE  = nH - std::min(shape.nInhibit, nH);
+    const uint64_t    split = nIO + (n - nIO)*nE/std::max(nH, 1u);   /* E/I */
+
+    /* synapse i from its draws x */
+    auto make = [&](uint64_t i, const uint32_t* x) -> SynapsePacked {
+        if(i < nIO) return { uint32_t(i / shape.nOutput), shape.nInput + uint32_t(i % shape.nOutput),
+                             in.lo + philox_u01(x[2])*(in.hi - in.lo), 0.f };
+        const uint32_t src = i < split ? h0 + scale(x[0], nE) : h0 + nE + scale(x[0], nH - nE);
+        return { src, h0 + scale(x[1], nH),
+                 hidden.lo + philox_u01(x[2])*(hidden.hi - hidden.lo), 0.f };
+    };
+
+    auto fill = [&](uint64_t b, uint64_t e, uint32_t){
+        std::vector<uint32_t> r(4*kGraphBatch);
+        for(uint64_t i0=b; i0<e; i0+=kGraphBatch){
+            const uint64_t k = std::min(kGraphBatch, e-i0);
+            philox_fill(key, kStreamGraph, 0, i0, 4*k, r.data());
+            for(uint64_t j=0; j<k; ++j) put(v, store, i0+j, make(i0+j, &r[4*j]));
+        }
+    };
+    if(pool) pool->parallel_for(n, fill);
+    else     fill(0, n, 0);
+}
+
+/* ===================================================================== */
+/* row h of the hidden block holds q or q+1 synapses and starts at
+   nIO + h·q + min(h, r); workers own neuron ranges, so rows never split */
+void build_row_graph(SynapseStore& store, const GraphShape& shape,
+                     const RowGenerator& gen, PhiloxKey key, ThreadPool* pool,
+                     WeightRange in, WeightRange hidden)
+{
+    const SynapseView v   = store.view();
+    const uint64_t    n   = store.size();
+    const uint64_t    nIO = std::min<uint64_t>(uint64_t(shape.nInput)*shape.nOutput, n);
+    const uint32_t    h0  = shape.nInput + shape.nOutput;
+    const uint32_t    nH  = shape.nNeuron - h0;
+
+    /* dense input→output block, already in (src, dst) order */
+    {
+        std::vector<uint32_t> r(4*kGraphBatch);
+        for(uint64_t i0=0; i0<nIO; i0+=kGraphBatch){
+            const uint64_t k = std::min(kGraphBatch, nIO-i0);
+            philox_fill(key, kStreamGraph, 0, i0, 4*k, r.data());
+            for(uint64_t j=0; j<k; ++j){
+                const uint64_t i = i0+j;
+                put(v, store, i, { uint32_t(i / shape.nOutput), shape.nInput + uint32_t(i % shape.nOutput),
+                                   in.lo + philox_u01(r[4*j+2])*(in.hi - in.lo), 0.f });
+            }
+        }
+    }
+    if(n==nIO || !nH) return;
+
+    const uint64_t q = (n - nIO) / nH;
+    const uint64_t r = (n - nIO) % nH;
+    auto off = [&](uint64_t h){ return nIO + h*q + std::min(h, r); };
+
+    /* draws for whole rows at a time, about kGraphBatch slots per call */
+    auto rows = [&](uint64_t b, uint64_t e, uint32_t){
+        std::vector<uint32_t> x, dst(q+1);
+        for(uint64_t h=b; h<e; ){
+            const uint64_t s0 = off(h);
+            uint64_t h1 = h+1;
+            while(h1 < e && off(h1+1) - s0 <= kGraphBatch) ++h1;
+            x.resize(4*(off(h1) - s0));
+            philox_fill(key, kStreamGraph, 0, s0, x.size(), x.data());
+            for(; h<h1; ++h){
+                const uint64_t  o   = off(h);
+                const uint32_t  deg = uint32_t(off(h+1) - o);
+                const uint32_t* xr  = &x[4*(o - s0)];
+                gen.row(uint32_t(h), deg, xr, dst.data());
+                std::sort(dst.begin(), dst.begin()+deg);
+                for(uint32_t j=0;j<deg;++j)
+                    put(v, store, o+j, { h0 + uint32_t(h), h0 + dst[j],
+                                         hidden.lo + philox_u01(xr[4*j+2])*(hidden.hi - hidden.lo), 0.f });
+            }
+        }
+    };
+    if(pool) pool->parallel_for(nH, rows);
+    else     rows(0, nH, 0);
+}
+
+/* ===================================================================== */
+void build_graph(SynapseStore& store, const GraphShape& shape,
+                 Topology topo, const TopologyParams& params,
+                 PhiloxKey key, ThreadPool* pool)
+{
+    const auto gen = make_row_generator(topo, shape.nNeuron - shape.nInput - shape.nOutput, params);
+    if(gen) build_row_graph(store, shape, *gen, key, pool);
+    else    build_random_graph(store, shape, key, pool);
+}
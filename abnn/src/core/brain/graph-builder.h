@@ -0,0 +1,96 @@
+#pragma once
+/* graph-builder.h  –  parallel, reproducible synapse graphs
+ * ====================================================================
+ * * Synapse i is a function of (key, i) alone: its draws are the four
+ *   Philox words of counter (i, kStreamGraph, pass 0), so the graph is
+ *   the same for any thread count and any range can be built on its own
+ * * The pool shards the work into one contiguous range per worker;
+ *   a worker generates draws in batches with philox_fill() (AVX-512 /
+ *   AVX2) and writes straight into the store, packed or SoA, in any
+ *   weight format
+ * * Every graph starts with the dense input→output block (synapse i =
+ *   input i / nOutput → output i % nOutput); the rest is hidden→hidden
+ * * Random: uniform src and dst, unordered (build_random_graph); with
+ *   inhibitory neurons the hidden slots are split in proportion, the
+ *   first part drawing excitatory sources and the rest inhibitory ones,
+ *   so the store holds one run per type
+ * * Row topologies (RowGenerator): every hidden neuron gets the same
+ *   out-degree ±1, so row h starts at a closed-form offset and is
+ *   written, sorted by dst, by whichever worker owns h. The store
+ *   comes out in (src, dst) order without a global sort (so already
+ *   partitioned by type, the inhibitory ids being last)
+ *     SmallWorld – Watts–Strogatz: ring lattice to the nearest ids,
+ *                  each edge rewired to a uniform target with beta
+ *     ScaleFree  – Barabási–Albert, mean-field: neuron t attaches to
+ *                  older neurons with probability ∝ their expected
+ *                  degree √(t/i), drawn in closed form as i = ⌊t·u²⌋
+ *                  (in-degree ~ k⁻³, hubs at low ids)
+ *     Distance2D / Distance3D – neurons on a row-major torus grid,
+ *                  targets at a Gaussian offset of sigma cells per axis
+ */
+
+#include <cstdint>
+#include <memory>
+#include "philox.h"
+#include "synapse-store.h"
+
+class ThreadPool;
+
+struct GraphShape
+{
+    uint32_t nInput;
+    uint32_t nOutput;
+    uint32_t nNeuron;           /* inputs, outputs, then hidden */
+    uint32_t nInhibit{0};       /* E/I: the last hidden ids      */
+};
+
+struct WeightRange { float lo, hi; };   /* uniform [lo, hi) */
+
+enum class Topology : uint32_t
+{
+    Random = 0, SmallWorld = 1, ScaleFree = 2, Distance2D = 3, Distance3D = 4
+};
+
+struct TopologyParams
+{
+    float beta {0.1f};          /* SmallWorld: rewiring probability      */
+    float sigma{8.0f};          /* Distance*: offset std-dev, grid cells */
+};
+
+const char* topology_name(Topology);
+
+/* ===================================================================== */
+/* a topology as rows: the out-synapses of each hidden neuron; row() is
+   called concurrently and must depend on its arguments only          */
+class RowGenerator
+{
+public:
+    virtual ~RowGenerator() = default;
+
+    /* deg targets of hidden neuron h, as hidden-local ids 0 … nHidden-1,
+       in any order, never h itself (unless it is the only one). x holds
+       4 Philox words per slot; word 2 is the slot's weight, words 0, 1,
+       3 are free for the generator                                   */
+    virtual void row(uint32_t h, uint32_t deg, const uint32_t* x, uint32_t* dst) const = 0;
+};
+
+/* nullptr for Random (not a row topology) */
+std::unique_ptr<RowGenerator> make_row_generator(Topology, uint32_t nHidden,
+                                                 const TopologyParams&);
+
+/* ===================================================================== */
+/* fill every synapse of store; pool nullptr → calling thread only */
+void build_random_graph(SynapseStore& store, const GraphShape& shape,
+                        PhiloxKey key, ThreadPool* pool,
+                        WeightRange in     = { 0.4f, 0.8f },
+                        WeightRange hidden = { 0.1f, 0.2f });
+
+void build_row_graph(SynapseStore& store, const GraphShape& shape,
+                     const RowGenerator& gen, PhiloxKey key, ThreadPool* pool,
+                     WeightRange in     = { 0.4f, 0.8f },
+                     WeightRange hidden = { 0.1f, 0.2f });
+
+/* either of the above by topology */
+void build_graph(SynapseStore& store, const GraphShape& shape,
+                 Topology topo, const TopologyParams& params,
+                 PhiloxKey key, ThreadPool* pool);
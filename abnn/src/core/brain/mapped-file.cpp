@@ -0,0 +1,45 @@
+// mapped-file.cpp  –  mmap / msync wrapper
+// ======================================================================
+
+#include "mapped-file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* ===================================================================== */
+bool MappedFile::open(const std::string& path, MapMode mode)
+{
+    close();
+
+    const bool shared = mode==MapMode::Shared;
+    const int  fd = ::open(path.c_str(), shared ? O_RDWR : O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat st{};
+    if(::fstat(fd, &st)!=0 || st.st_size<=0){ ::close(fd); return false; }
+
+    /* private mappings may still be written: those pages become copies,
+       reserved only when a write copies them                          */
+    void* p = ::mmap(nullptr, uint64_t(st.st_size), PROT_READ|PROT_WRITE,
+                     shared ? MAP_SHARED : MAP_PRIVATE|MAP_NORESERVE, fd, 0);
+    ::close(fd);                                /* the mapping keeps the file */
+    if(p==MAP_FAILED) return false;
+
+    p_ = static_cast<uint8_t*>(p); n_ = uint64_t(st.st_size);
+    mode_ = mode; path_ = path;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(p_) ::munmap(p_, n_);
+    p_ = nullptr; n_ = 0; path_.clear();
+}
+
+bool MappedFile::sync()
+{
+    if(!p_ || mode_!=MapMode::Shared) return true;
+    return ::msync(p_, n_, MS_SYNC)==0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+/* mapped-file.h  –  whole-file memory mapping for zero-copy .bnn loads
+ * ====================================================================
+ * * Private : copy-on-write; pages fault in from the file on first
+ *             read, a write copies the page and never reaches the file
+ * * Shared  : writes go to the page cache and back to the file (sync()
+ *             forces them out), so training persists in place
+ * * Nothing is read up front; the mapping stays valid until close()
+ *   even if the path is renamed over (the inode lives on)
+ */
+
+#include <cstdint>
+#include <string>
+
+enum class MapMode : uint32_t { Private = 0, Shared = 1 };
+
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /* false → cannot open / map (missing, read-only for Shared, empty) */
+    bool open(const std::string& path, MapMode mode);
+    void close();
+
+    /* flush dirty pages of a Shared mapping; no-op for Private */
+    bool sync();
+
+    uint8_t*           data() const { return p_;    }
+    uint64_t           size() const { return n_;    }
+    MapMode            mode() const { return mode_; }
+    const std::string& path() const { return path_; }
+
+private:
+    uint8_t*    p_{nullptr};
+    uint64_t    n_{0};
+    MapMode     mode_{MapMode::Private};
+    std::string path_;
+};
@@ -0,0 +1,128 @@
+// neuron-order.cpp  –  degree / reverse Cuthill–McKee relabelling
+// ======================================================================
+
+#include "neuron-order.h"
+
+#include <algorithm>
+#include <numeric>
+
+/* ===================================================================== */
+const char* neuron_order_name(NeuronOrder o)
+{
+    switch(o){
+        case NeuronOrder::Degree: return "degree";
+        case NeuronOrder::Rcm:    return "RCM";
+        default:                  return "none";
+    }
+}
+
+/* ===================================================================== */
+/* in+out degree per neuron                                              */
+static std::vector<uint64_t> degrees(const SynapseStore& s, const SourceIndex& idx)
+{
+    const uint32_t  nNrn   = idx.n_rows();
+    const uint64_t* rowPtr = idx.offsets();
+
+    std::vector<uint64_t> deg(nNrn);
+    for(uint32_t n=0;n<nNrn;++n) deg[n] = rowPtr[n+1]-rowPtr[n];
+    for(uint64_t i=0;i<s.size();++i) if(!s.is_free(i)) ++deg[s.get(i).dst];
+    return deg;
+}
+
+/* ===================================================================== */
+std::vector<uint32_t> neuron_order(const SynapseStore& store,
+                                   const SourceIndex&  idx,
+                                   uint32_t            nFixed,
+                                   NeuronOrder         order)
+{
+    const uint32_t nNrn = idx.n_rows();
+
+    std::vector<uint32_t> newId(nNrn);
+    std::iota(newId.begin(), newId.end(), 0u);
+    if(order==NeuronOrder::None || nFixed>=nNrn) return newId;
+
+    const auto deg = degrees(store, idx);
+
+    /* hidden ids, ascending degree (ties: current id) ------------------ */
+    std::vector<uint32_t> byDeg(nNrn-nFixed);
+    std::iota(byDeg.begin(), byDeg.end(), nFixed);
+    std::stable_sort(byDeg.begin(), byDeg.end(),
+                     [&](uint32_t a, uint32_t b){ return deg[a] < deg[b]; });
+
+    std::vector<uint32_t> seq;                 /* old ids in new order */
+    seq.reserve(nNrn-nFixed);
+
+    if(order==NeuronOrder::Degree){
+        seq.resize(nNrn-nFixed);
+        std::iota(seq.begin(), seq.end(), nFixed);
+        std::stable_sort(seq.begin(), seq.end(),
+                         [&](uint32_t a, uint32_t b){ return deg[a] > deg[b]; });
+    } else {
+        /* Cuthill–McKee: BFS from the lowest-degree unvisited neuron,
+           neighbours appended by ascending degree; then reversed      */
+        const uint64_t* rowPtr = idx.offsets();
+        std::vector<uint8_t>  seen(nNrn, 0);
+        std::vector<uint32_t> nbr;
+
+        for(uint32_t root : byDeg){
+            if(seen[root]) continue;
+            seen[root] = 1;
+            size_t head = seq.size();
+            seq.push_back(root);
+
+            while(head < seq.size()){
+                const uint32_t n = seq[head++];
+                nbr.clear();
+                for(uint64_t i=rowPtr[n]; i<rowPtr[n+1]; ++i){
+                    const uint32_t d = store.get(i).dst;
+                    if(d>=nFixed && !seen[d]){ seen[d]=1; nbr.push_back(d); }
+                }
+                std::sort(nbr.begin(), nbr.end(), [&](uint32_t a, uint32_t b){
+                    return deg[a]!=deg[b] ? deg[a]<deg[b] : a<b; });
+                seq.insert(seq.end(), nbr.begin(), nbr.end());
+            }
+        }
+        std::reverse(seq.begin(), seq.end());
+    }
+
+    for(uint32_t k=0;k<seq.size();++k) newId[seq[k]] = nFixed + k;
+    return newId;
+}
+
+/* ===================================================================== */
+bool sorted_by_src_dst(const SynapseStore& s)
+{
+    for(uint64_t i=1;i<s.size();++i){
+        const SynapsePacked a = s.get(i-1), b = s.get(i);
+        if(a.src!=b.src ? a.src>b.src : a.dst>b.dst) return false;
+    }
+    return true;
+}
+
+/* ===================================================================== */
+void relabel_neurons(SynapseStore& store, const std::vector<uint32_t>& newId)
+{
+    for(uint64_t i=0;i<store.size();++i){
+        SynapsePacked s = store.get(i);
+        if(s.src==kFreeSyn) continue;
+        s.src = newId[s.src];
+        s.dst = newId[s.dst];
+        store.set(i, s);
+    }
+
+    /* rows by src (free slots last), then each row by dst */
+    SourceIndex idx;
+    idx.build(store, uint32_t(newId.size()));
+
+    const uint64_t* rowPtr = idx.offsets();
+    std::vector<SynapsePacked> row;
+    for(uint32_t n=0;n<idx.n_rows();++n){
+        const uint64_t b = rowPtr[n], e = rowPtr[n+1];
+        if(e-b < 2) continue;
+        row.resize(e-b);
+        store.to_packed(row.data(), b, e-b);
+        std::sort(row.begin(), row.end(), [](const SynapsePacked& x,
+                                             const SynapsePacked& y){ return x.dst < y.dst; });
+        store.from_packed(row.data(), b, e-b);
+    }
+}
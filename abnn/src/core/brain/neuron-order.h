@@ -0,0 +1,36 @@
+#pragma once
+/* neuron-order.h  –  locality-improving neuron relabelling
+ * ====================================================================
+ * * Degree : hidden neurons by descending in+out degree, so the hot
+ *            lastFired entries share a few cache lines
+ * * Rcm    : reverse Cuthill–McKee over the out-edges; neighbours get
+ *            nearby ids, so the lastFired[src]/[dst] gathers of a row
+ *            stay within a small window of the array
+ * * Ids below nFixed (inputs, outputs) never move, so inject_inputs,
+ *   read_outputs and teacher forcing are unaffected
+ * * relabel_neurons() rewrites src/dst and re-sorts the synapses by
+ *   (src, dst); the resulting dense scan reads lastFired[src] in order.
+ *   Free slots (kFreeSyn) keep no neuron and end up behind the rows
+ */
+
+#include <cstdint>
+#include <vector>
+#include "synapse-store.h"
+#include "source-index.h"
+
+enum class NeuronOrder : uint32_t { None = 0, Degree = 1, Rcm = 2 };
+
+const char* neuron_order_name(NeuronOrder);
+
+/* newId[old] for every neuron; rows must come from idx built on store */
+std::vector<uint32_t> neuron_order(const SynapseStore& store,
+                                   const SourceIndex&  idx,
+                                   uint32_t            nFixed,
+                                   NeuronOrder         order);
+
+/* true once relabel_neurons() has run (or the graph happens to be in
+   (src, dst) order); used to skip the on-load pass for ordered files */
+bool sorted_by_src_dst(const SynapseStore& store);
+
+/* apply newId to src/dst and restore (src, dst) order */
+void relabel_neurons(SynapseStore& store, const std::vector<uint32_t>& newId);
@@ -0,0 +1,70 @@
+// source-index.cpp  –  in-place CSR ordering of the synapse array
+// ======================================================================
+
+#include "source-index.h"
+
+#include <algorithm>
+#include <cassert>
+
+/* ===================================================================== */
+void SourceIndex::build(SynapseStore& store, uint32_t nNrn)
+{
+    const uint64_t n = store.size();
+
+    /* free slots (src kFreeSyn) count as row nNrn: after the last row */
+    auto row = [nNrn](uint32_t s){ return s==kFreeSyn ? nNrn : s; };
+
+    /* ---------- row sizes → offsets ---------------------------------- */
+    std::vector<uint64_t> off(uint64_t(nNrn)+2, 0);
+    for(uint64_t i=0;i<n;++i){
+        assert(store.src(i) < nNrn || store.is_free(i));
+        ++off[row(store.src(i))+1];
+    }
+    for(uint32_t r=0;r<=nNrn;++r) off[r+1] += off[r];
+
+    /* ---------- cycle-leader permutation ----------------------------- */
+    /* every swap drops one synapse into its final row, so the loop does
+       at most N_SYN swaps and none at all on sorted input               */
+    std::vector<uint64_t> next(off.begin(), off.end()-1);
+    for(uint32_t r=0;r<=nNrn;++r){
+        while(next[r] < off[r+1]){
+            const uint64_t i = next[r];
+            const uint32_t s = row(store.src(i));
+            if(s==r){ ++next[r]; continue; }
+            store.swap(i, next[s]++);
+        }
+    }
+    off.pop_back();
+    rowPtr_ = std::move(off);
+}
+
+/* ===================================================================== */
+/* from the last row down, old row r slides up by the new synapses of
+   the rows before it (one move per row) and its new synapses follow.
+   Rows past the old ones are in place already; only the new synapses
+   of old rows go through a copy, since the slides overwrite them      */
+void SourceIndex::append(SynapseStore& store, uint64_t first, uint64_t end, uint32_t nNrn)
+{
+    const uint32_t nOld = n_rows();
+    assert(!empty() && rowPtr_.back()==first && nNrn >= nOld);
+
+    std::vector<uint64_t> cnt(uint64_t(nNrn)+1, 0);  /* → new synapses before row r */
+    for(uint64_t i=first;i<end;++i){
+        assert(store.src(i) < nNrn && (i==first || store.src(i-1) <= store.src(i)));
+        ++cnt[store.src(i)+1];
+    }
+    for(uint32_t r=0;r<nNrn;++r) cnt[r+1] += cnt[r];
+
+    std::vector<SynapsePacked> add(cnt[nOld]);
+    store.to_packed(add.data(), first, add.size());
+
+    rowPtr_.resize(uint64_t(nNrn)+1, first);
+    for(uint32_t r=nNrn; r-- > 0; ){
+        const uint64_t b = rowPtr_[r], e = rowPtr_[r+1];
+        if(r < nOld){
+            if(cnt[r] && e > b)  store.move(b + cnt[r], b, e - b);
+            if(cnt[r+1] > cnt[r]) store.from_packed(&add[cnt[r]], e + cnt[r], cnt[r+1] - cnt[r]);
+        }
+        rowPtr_[r+1] = e + cnt[r+1];
+    }
+}
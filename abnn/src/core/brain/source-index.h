@@ -0,0 +1,40 @@
+#pragma once
+/* source-index.h  –  CSR view of the synapse array keyed by src
+ * ====================================================================
+ * * build() sorts the store by presynaptic neuron in place (O(N_SYN)
+ *   cycle-leader counting sort, no second copy of the synapses) and
+ *   records the row offsets: the outgoing synapses of neuron n are
+ *   [offsets()[n], offsets()[n+1])
+ * * Free slots (kFreeSyn) are sorted behind the last row, so a store
+ *   with holes comes out compacted
+ * * An already sorted store (e.g. a .bnn saved in CSR order) only
+ *   pays for the counting pass
+ * * append() takes a block of new synapses, already in src order and
+ *   written behind the rows, into the index: merged in from the back,
+ *   one move per row, without a full rebuild
+ * * Any host write that moves synapses between sources invalidates the
+ *   index; Brain rebuilds it from synapses_modified()
+ */
+
+#include <cstdint>
+#include <vector>
+#include "synapse-store.h"
+
+/* ===================================================================== */
+class SourceIndex
+{
+public:
+    void build(SynapseStore& store, uint32_t nNrn);
+    void clear() { rowPtr_.clear(); rowPtr_.shrink_to_fit(); }
+
+    /* new synapses [first, end) in src order, first = end of the rows,
+       free slots from end on; rows grow to nNrn (≥ n_rows())           */
+    void append(SynapseStore& store, uint64_t first, uint64_t end, uint32_t nNrn);
+
+    bool            empty()   const { return rowPtr_.empty(); }
+    const uint64_t* offsets() const { return rowPtr_.data();  }
+    uint32_t        n_rows()  const { return empty() ? 0 : uint32_t(rowPtr_.size()-1); }
+
+private:
+    std::vector<uint64_t> rowPtr_;      /* nNrn+1 offsets */
+};
@@ -0,0 +1,398 @@
+// synapse-store.cpp  –  packed / SoA synapse arrays
+// ======================================================================
+
+#include "synapse-store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <thread>
+
+/* ===================================================================== */
+void SynapseStore::release()
+{
+    pkStore_.release();
+    srcStore_.release();
+    dstStore_.release();
+    wStore_.release();
+    w16Store_.release();
+    w8Store_.release();
+    dirtyStore_.release();
+    thaw();
+    file_.reset();
+    pk_ = nullptr; src_ = dst_ = nullptr; w_ = nullptr; w16_ = nullptr; w8_ = nullptr;
+    dirty_ = nullptr;
+    external_ = false;
+    restructured_ = true;
+}
+
+void SynapseStore::allocate(uint64_t n, SynapseLayout layout,
+                            WeightFormat fmt, float lo, float hi)
+{
+    release();
+    if(fmt!=WeightFormat::F32) layout = SynapseLayout::SoA;
+    n_ = n; layout_ = layout; wfmt_ = fmt; wLo_ = lo; wHi_ = hi;
+    const uint64_t cap = std::max(wantCap_, n);
+    dirtyStore_.allocate((n + kDirtyBlock-1) >> kDirtyShift, HostPages::Base,
+                         (cap + kDirtyBlock-1) >> kDirtyShift);
+    dirty_ = dirtyStore_.data();
+
+    if(layout==SynapseLayout::Packed){
+        pkStore_.allocate(n, wantPages_, cap);
+        pk_ = pkStore_.data();
+        return;
+    }
+    srcStore_.allocate(n, wantPages_, cap); dstStore_.allocate(n, wantPages_, cap);
+    src_ = srcStore_.data(); dst_ = dstStore_.data();
+    switch(fmt){
+        case WeightFormat::F32: wStore_.allocate(n, wantPages_, cap);   w_   = wStore_.data();   break;
+        case WeightFormat::U8:  w8Store_.allocate(n, wantPages_, cap);  w8_  = w8Store_.data();  break;
+        default:                w16Store_.allocate(n, wantPages_, cap); w16_ = w16Store_.data(); break;
+    }
+}
+
+uint64_t SynapseStore::capacity() const
+{
+    if(external_ || file_) return n_;
+    return layout_==SynapseLayout::Packed ? pkStore_.capacity() : srcStore_.capacity();
+}
+
+bool SynapseStore::grow(uint64_t n)
+{
+    if(external_ || file_ || frozen() || n < n_ || n > capacity()) return false;
+    if(!dirtyStore_.grow((n + kDirtyBlock-1) >> kDirtyShift)) return false;
+    bool ok = true;
+    if(layout_==SynapseLayout::Packed) ok = pkStore_.grow(n);
+    else {
+        ok = srcStore_.grow(n) && dstStore_.grow(n);
+        switch(wfmt_){
+            case WeightFormat::F32: ok = ok && wStore_.grow(n);   break;
+            case WeightFormat::U8:  ok = ok && w8Store_.grow(n);  break;
+            default:                ok = ok && w16Store_.grow(n); break;
+        }
+    }
+    if(!ok) return false;
+    n_ = n;
+    restructured_ = true;
+    return true;
+}
+
+void SynapseStore::attach_packed(SynapsePacked* p, uint64_t n)
+{
+    release();
+    n_ = n; layout_ = SynapseLayout::Packed; wfmt_ = WeightFormat::F32;
+    pk_ = p; external_ = true;
+}
+
+void SynapseStore::attach_mapped(std::unique_ptr<MappedFile> file, const uint64_t off[3], uint64_t n,
+                                 SynapseLayout layout, WeightFormat fmt, float lo, float hi)
+{
+    release();
+    n_ = n; layout_ = layout; wfmt_ = fmt; wLo_ = lo; wHi_ = hi;
+    file_ = std::move(file);
+    dirtyStore_.allocate((n + kDirtyBlock-1) >> kDirtyShift);
+    dirty_ = dirtyStore_.data();
+
+    uint8_t* p = file_->data();
+    if(layout==SynapseLayout::Packed){
+        pk_ = reinterpret_cast<SynapsePacked*>(p + off[0]);
+        return;
+    }
+    src_ = reinterpret_cast<uint32_t*>(p + off[0]);
+    dst_ = reinterpret_cast<uint32_t*>(p + off[1]);
+    switch(fmt){
+        case WeightFormat::F32: w_   = reinterpret_cast<float*>   (p + off[2]); break;
+        case WeightFormat::U8:  w8_  =                             p + off[2];  break;
+        default:                w16_ = reinterpret_cast<uint16_t*>(p + off[2]); break;
+    }
+}
+
+uint64_t SynapseStore::bytes() const
+{
+    return layout_==SynapseLayout::Packed
+         ? n_*sizeof(SynapsePacked)
+         : n_*(2*sizeof(uint32_t)+weight_bytes(wfmt_));
+}
+
+void* SynapseStore::weights() const
+{
+    switch(wfmt_){
+        case WeightFormat::F32: return w_;
+        case WeightFormat::U8:  return w8_;
+        default:                return w16_;
+    }
+}
+
+HostPages SynapseStore::pages() const
+{
+    return layout_==SynapseLayout::Packed ? pkStore_.pages() : srcStore_.pages();
+}
+
+std::vector<SynapseStore::Array> SynapseStore::arrays() const
+{
+    if(external_) return {};
+    if(layout_==SynapseLayout::Packed)
+        return { { pk_, uint32_t(sizeof(SynapsePacked)), host_page_bytes(pkStore_.pages()) } };
+
+    const uint64_t wPage = wfmt_==WeightFormat::F32 ? host_page_bytes(wStore_.pages())
+                         : wfmt_==WeightFormat::U8  ? host_page_bytes(w8Store_.pages())
+                         :                            host_page_bytes(w16Store_.pages());
+    return { { src_, 4u, host_page_bytes(srcStore_.pages()) },
+             { dst_, 4u, host_page_bytes(dstStore_.pages()) },
+             { weights(), weight_bytes(wfmt_), wPage } };
+}
+
+/* ===================================================================== */
+uint64_t SynapseStore::count_dirty() const
+{
+    uint64_t k = 0;
+    for(uint64_t b=0;b<dirtyStore_.size();++b) k += dirty_[b]!=0;
+    return k;
+}
+
+void SynapseStore::clear_dirty()
+{
+    std::fill(dirty_, dirty_ + dirtyStore_.size(), uint8_t(0));
+    restructured_ = false;
+}
+
+/* ===================================================================== */
+/* copy-on-write snapshot. The shadow array is reserved, not touched:
+   only blocks a kernel writes before the reader gets to them cost
+   memory. Between passes nothing else runs, so freeze() / thaw() need
+   no synchronisation with the kernels                                 */
+void SynapseStore::freeze(const uint8_t* keep)
+{
+    assert(!external_ && !frozen());
+    const uint64_t nBlocks = (n_ + kDirtyBlock-1) >> kDirtyShift;
+    frozenStore_.allocate(nBlocks);
+    shadowStore_.allocate(n_*weight_bytes(wfmt_));
+    if(keep)
+        for(uint64_t b=0;b<nBlocks;++b) frozenStore_[b] = keep[b] ? kFrozenLive : kFrozenDone;
+    frozen_ = { frozenStore_.data(), shadowStore_.data(), n_ };
+}
+
+void SynapseStore::thaw()
+{
+    frozen_ = {};
+    frozenStore_.release();
+    shadowStore_.release();
+}
+
+/* weights of [i0, i0+n) in the store's format: packed .w or the SoA array */
+static void copy_weights(const SynapseView& v, uint64_t i0, uint64_t n, uint8_t* out)
+{
+    if(v.layout==SynapseLayout::Packed){
+        for(uint64_t k=0;k<n;++k) std::memcpy(out + 4*k, &v.pk[i0+k].w, 4);
+        return;
+    }
+    const uint32_t wb = weight_bytes(v.wfmt);
+    const void*    w  = v.wfmt==WeightFormat::F32 ? static_cast<const void*>(v.w)
+                      : v.wfmt==WeightFormat::U8  ? static_cast<const void*>(v.w8)
+                      :                             static_cast<const void*>(v.w16);
+    std::memcpy(out, static_cast<const uint8_t*>(w) + i0*wb, n*wb);
+}
+
+void freeze_block(const SynapseView& v, uint64_t b)
+{
+    const FrozenWeights& f = *v.frozen;
+    std::atomic_ref<uint8_t> s(f.state[b]);
+    for(;;){
+        uint8_t x = s.load(std::memory_order_acquire);
+        if(x >= kFrozenSaved) return;
+        if(x == kFrozenLive && s.compare_exchange_strong(x, kFrozenBusy, std::memory_order_acquire)){
+            const uint64_t i0 = b << kDirtyShift;
+            copy_weights(v, i0, std::min(kDirtyBlock, f.n - i0), f.shadow + i0*weight_bytes(v.wfmt));
+            s.store(kFrozenSaved, std::memory_order_release);
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+const uint8_t* SynapseStore::read_frozen(int a, uint64_t first, uint64_t n,
+                                         std::vector<uint8_t>& stage) const
+{
+    assert(frozen() && (first & (kDirtyBlock-1))==0);
+    const SynapseView v  = view();
+    const uint32_t    wb = weight_bytes(wfmt_);
+    if(layout_==SynapseLayout::SoA && a < 2)
+        return reinterpret_cast<const uint8_t*>((a==0 ? src_ : dst_) + first);
+
+    const uint32_t eb = layout_==SynapseLayout::Packed ? uint32_t(sizeof(SynapsePacked)) : wb;
+    stage.resize(n*eb);
+    for(uint64_t i=first; i<first+n; i+=kDirtyBlock){
+        const uint64_t k   = std::min(kDirtyBlock, first+n-i);
+        uint8_t*       out = stage.data() + (i-first)*eb;
+        std::atomic_ref<uint8_t> s(frozen_.state[i >> kDirtyShift]);
+        for(;;){
+            uint8_t x = s.load(std::memory_order_acquire);
+            assert(x != kFrozenDone && "frozen block read twice or not kept");
+            if(x == kFrozenLive && s.compare_exchange_strong(x, kFrozenBusy, std::memory_order_acquire)){
+                /* ours now: kernels wait until the copy is out */
+                if(layout_==SynapseLayout::Packed) std::memcpy(out, pk_ + i, k*eb);
+                else                               copy_weights(v, i, k, out);
+                s.store(kFrozenDone, std::memory_order_release);
+                break;
+            }
+            if(x == kFrozenSaved){
+                /* weights from the shadow; packed src / dst / pad never change */
+                const uint8_t* sh = frozen_.shadow + i*wb;
+                if(layout_==SynapseLayout::SoA){ std::memcpy(out, sh, k*wb); break; }
+                SynapsePacked* o = reinterpret_cast<SynapsePacked*>(out);
+                for(uint64_t j=0;j<k;++j){
+                    o[j].src = pk_[i+j].src; o[j].dst = pk_[i+j].dst; o[j].pad = pk_[i+j].pad;
+                    std::memcpy(&o[j].w, sh + 4*j, 4);
+                }
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
+    return stage.data();
+}
+
+/* ===================================================================== */
+float SynapseStore::weight(uint64_t i) const
+{
+    switch(wfmt_){
+        case WeightFormat::F16:  return decode_f16(w16_[i]);
+        case WeightFormat::BF16: return decode_bf16(w16_[i]);
+        case WeightFormat::U8:   return decode_u8(w8_[i], wLo_, (wHi_-wLo_)*(1.0f/255.0f));
+        default:                 return w_[i];
+    }
+}
+
+void SynapseStore::set_weight(uint64_t i, float w, uint32_t r)
+{
+    switch(wfmt_){
+        case WeightFormat::F16:  w16_[i] = encode_f16(w, r);  break;
+        case WeightFormat::BF16: w16_[i] = encode_bf16(w, r); break;
+        case WeightFormat::U8:   w8_[i]  = encode_u8(w, wLo_, 1.0f/((wHi_-wLo_)*(1.0f/255.0f)), r); break;
+        default:                 w_[i]   = w; break;
+    }
+}
+
+/* ===================================================================== */
+/* structural plasticity                                                 */
+uint64_t SynapseStore::prune(uint64_t first, uint64_t n, float wPrune)
+{
+    assert(first+n<=n_);
+    uint64_t k = 0;
+    for(uint64_t i=first;i<first+n;++i){
+        if(src(i)==kFreeSyn) continue;
+        const float w = layout_==SynapseLayout::Packed ? pk_[i].w : weight(i);
+        if(w >= wPrune) continue;
+        free_range(i, 1);
+        ++k;
+    }
+    return k;
+}
+
+/* a[i] for the live i of the range, in order, to the front of the range */
+template<class T>
+static void compact_by(T* a, const uint32_t* src, uint64_t first, uint64_t n)
+{
+    uint64_t o = first;
+    for(uint64_t i=first;i<first+n;++i) if(src[i]!=kFreeSyn) a[o++] = a[i];
+}
+
+uint64_t SynapseStore::compact(uint64_t first, uint64_t n)
+{
+    assert(first+n<=n_);
+    uint64_t live = 0;
+    if(layout_==SynapseLayout::Packed){
+        for(uint64_t i=first;i<first+n;++i) if(pk_[i].src!=kFreeSyn) pk_[first + live++] = pk_[i];
+    } else {
+        /* src decides, so it goes last */
+        compact_by(dst_, src_, first, n);
+        switch(wfmt_){
+            case WeightFormat::F32: compact_by(w_,   src_, first, n); break;
+            case WeightFormat::U8:  compact_by(w8_,  src_, first, n); break;
+            default:                compact_by(w16_, src_, first, n); break;
+        }
+        for(uint64_t i=first;i<first+n;++i) if(src_[i]!=kFreeSyn) src_[first + live++] = src_[i];
+    }
+    free_range(first+live, n-live);
+    return live;
+}
+
+void SynapseStore::move(uint64_t to, uint64_t from, uint64_t n)
+{
+    assert(to+n<=n_ && from+n<=n_);
+    if(to==from || !n) return;
+    if(layout_==SynapseLayout::Packed){
+        std::memmove(pk_+to, pk_+from, n*sizeof(SynapsePacked));
+        return;
+    }
+    const uint32_t wb = weight_bytes(wfmt_);
+    uint8_t*       w  = static_cast<uint8_t*>(weights());
+    std::memmove(src_+to, src_+from, n*4);
+    std::memmove(dst_+to, dst_+from, n*4);
+    std::memmove(w + to*wb, w + from*wb, n*wb);
+}
+
+void SynapseStore::free_range(uint64_t first, uint64_t n)
+{
+    assert(first+n<=n_);
+    if(layout_==SynapseLayout::Packed){
+        std::fill(pk_+first, pk_+first+n, kFreeSynapse);
+        return;
+    }
+    const uint32_t wb = weight_bytes(wfmt_);
+    std::fill(src_+first, src_+first+n, kFreeSyn);
+    std::fill(dst_+first, dst_+first+n, kFreeSyn);
+    std::memset(static_cast<uint8_t*>(weights()) + first*wb, 0, n*wb);
+}
+
+/* ===================================================================== */
+/* layout / format change: build the new arrays, then drop the old ones  */
+void SynapseStore::convert(SynapseLayout layout, WeightFormat fmt)
+{
+    if(fmt!=WeightFormat::F32) layout = SynapseLayout::SoA;
+    if(layout==layout_ && fmt==wfmt_) return;
+    assert(!external_ && "cannot re-layout an attached buffer");
+    assert(!frozen() && "snapshot in progress");
+
+    SynapseStore next;
+    next.wantPages_ = wantPages_;
+    next.wantCap_   = wantCap_;
+    next.allocate(n_, layout, fmt, wLo_, wHi_);
+
+    constexpr uint64_t kChunk = 1u<<16;
+    std::vector<SynapsePacked> buf(std::min(kChunk, n_));
+    for(uint64_t i=0;i<n_;i+=kChunk){
+        uint64_t n = std::min(kChunk, n_-i);
+        to_packed(buf.data(), i, n);
+        next.from_packed(buf.data(), i, n);
+    }
+    *this = std::move(next);
+}
+
+/* ===================================================================== */
+void SynapseStore::from_packed(const SynapsePacked* in, uint64_t first, uint64_t n)
+{
+    assert(first+n<=n_);
+    restructured_ = true;
+    if(layout_==SynapseLayout::Packed){
+        std::copy(in, in+n, pk_+first);
+        return;
+    }
+    for(uint64_t i=0;i<n;++i){
+        src_[first+i] = in[i].src;
+        dst_[first+i] = in[i].dst;
+        set_weight(first+i, in[i].w, kRoundNearest);
+    }
+}
+
+void SynapseStore::to_packed(SynapsePacked* out, uint64_t first, uint64_t n) const
+{
+    assert(first+n<=n_);
+    if(layout_==SynapseLayout::Packed){
+        std::copy(pk_+first, pk_+first+n, out);
+        return;
+    }
+    for(uint64_t i=0;i<n;++i)
+        out[i] = { src_[first+i], dst_[first+i], weight(first+i), 0.f };
+}
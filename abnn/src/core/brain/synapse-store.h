@@ -0,0 +1,244 @@
+#pragma once
+/* synapse-store.h  –  synapse arrays in packed or SoA layout
+ * ====================================================================
+ * * Packed : SynapsePacked[] {src,dst,w,pad}, 16 B / synapse, the layout
+ *            brain.metal and the .bnn payload use
+ * * SoA    : src[], dst[], w[] – 12 B / synapse; the gating scan only
+ *            streams src[] (4 B) and touches dst/w for gated synapses
+ * * SoA weights may be stored as fp16, bf16 or u8 over [lo, hi] (see
+ *   weight-codec.h): 10 / 10 / 9 B per synapse. Packed is always f32
+ * * Conversion between layouts is lossless for f32 (pad is always 0 and
+ *   is rebuilt as 0 on the way back); narrowing a format rounds to
+ *   nearest, widening is exact
+ * * attach_packed() wraps external memory (a Metal buffer) instead of
+ *   owning it; such a store cannot change layout
+ * * attach_mapped() takes over a mapped .bnn file and points the arrays
+ *   into its payload (zero-copy load); convert() copies such a store
+ *   into owned arrays and drops the mapping
+ * * Owned arrays are HostArray mappings: untouched until first use, so
+ *   the CPU backend can place each shard's pages (see numa.h), and
+ *   backed by huge pages when set_pages() asks for them
+ * * Owned stores keep a dirty map, one byte per kDirtyBlock synapses,
+ *   that the CPU kernels set when they write a weight of the block
+ *   back. Host writes that can move synapses (set, swap, from_packed,
+ *   a new allocation) set restructured() instead; both are reset by
+ *   clear_dirty() once the store matches a checkpoint
+ * * freeze() starts a copy-on-write snapshot of the weights: before a
+ *   kernel first writes a block it moves the block's old weights to a
+ *   shadow array (freeze_block), and read_frozen() returns elements as
+ *   they were at freeze() – from another thread, while passes go on
+ * * Free slots hold kFreeSynapse (brain-types.h). prune(), compact(),
+ *   move() and free_range() work on one range each and may run on
+ *   disjoint ranges concurrently; they leave restructured() to the
+ *   caller (mark_restructured, once)
+ */
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "brain-types.h"
+#include "host-array.h"
+#include "mapped-file.h"
+#include "weight-codec.h"
+
+enum class SynapseLayout : uint32_t { Packed = 0, SoA = 1 };
+
+static constexpr uint32_t kDirtyShift = 12;
+static constexpr uint64_t kDirtyBlock = 1ull<<kDirtyShift;   /* synapses */
+
+/* per-block state of a frozen store ------------------------------------ */
+enum : uint8_t
+{
+    kFrozenLive  = 0,     /* store holds the frozen weights             */
+    kFrozenBusy  = 1,     /* being copied by a kernel or the reader     */
+    kFrozenSaved = 2,     /* frozen weights are in the shadow array     */
+    kFrozenDone  = 3      /* read already, or not part of the snapshot  */
+};
+
+struct FrozenWeights
+{
+    uint8_t* state;       /* 1 / kDirtyBlock synapses                   */
+    uint8_t* shadow;      /* weights in the store's format (packed: f32) */
+    uint64_t n;           /* synapses                                   */
+};
+
+/* raw pointers handed to kernels; unused members are nullptr ----------- */
+struct SynapseView
+{
+    SynapseLayout  layout;
+    WeightFormat   wfmt;
+    SynapsePacked* pk;
+    uint32_t*      src;
+    uint32_t*      dst;
+    float*         w;             /* SoA f32                 */
+    uint16_t*      w16;           /* SoA fp16 / bf16         */
+    uint8_t*       w8;            /* SoA u8                  */
+    float          wLo, wStep;    /* u8: w = wLo + q·wStep   */
+    uint8_t*       dirty;         /* 1 / kDirtyBlock synapses, nullptr → untracked */
+    const FrozenWeights* frozen;  /* nullptr → no snapshot in progress */
+};
+
+/* kernel side of a frozen store: keep the old weights of block b before
+   the first write to it; waits while another thread copies the block */
+void freeze_block(const SynapseView& v, uint64_t b);
+
+/* ===================================================================== */
+class SynapseStore
+{
+public:
+    /* fmt other than F32 implies the SoA layout; [lo, hi] is the u8 range */
+    void allocate(uint64_t n, SynapseLayout layout,
+                  WeightFormat fmt = WeightFormat::F32,
+                  float lo = 0.f, float hi = 1.f);
+    void attach_packed(SynapsePacked* p, uint64_t n);
+
+    /* n synapses of the given layout / format inside file: the packed
+       array at file->data()+off[0], or src / dst / weights at off[0..2] */
+    void attach_mapped(std::unique_ptr<MappedFile> file, const uint64_t off[3], uint64_t n,
+                       SynapseLayout layout, WeightFormat fmt, float lo, float hi);
+    MappedFile*       mapped()       { return file_.get(); }
+    const MappedFile* mapped() const { return file_.get(); }
+
+    /* page size requested by later allocations (falls back, see
+       host-array.h); pages() is what the current arrays obtained    */
+    void      set_pages(HostPages p) { wantPages_ = p; }
+    HostPages pages() const;
+
+    /* slots later allocations reserve address space for (host-array.h);
+       grow() extends an owned store into them in place, so views and
+       indices stay valid. The new slots are zero, not free: the caller
+       writes every one of them. false → attached / mapped storage,
+       a snapshot in progress or beyond the reservation               */
+    void     set_capacity(uint64_t n) { wantCap_ = n; }
+    uint64_t capacity() const;
+    bool     grow(uint64_t n);
+
+    /* in-place layout / weight-format change (owned storage only) */
+    void convert(SynapseLayout layout, WeightFormat fmt = WeightFormat::F32);
+
+    SynapseLayout layout()        const { return layout_; }
+    WeightFormat  weight_format() const { return wfmt_;   }
+    float         weight_lo()     const { return wLo_;    }
+    float         weight_hi()     const { return wHi_;    }
+    uint64_t      size()          const { return n_; }
+    uint64_t      bytes()         const;
+    SynapseView   view()          const
+    {
+        return { layout_, wfmt_, pk_, src_, dst_, w_, w16_, w8_,
+                 wLo_, (wHi_-wLo_)*(1.0f/255.0f), dirty_,
+                 frozen_.state ? &frozen_ : nullptr };
+    }
+
+    /* changes since the last checkpoint (see the file comment) */
+    bool           tracks_dirty()  const { return dirty_ != nullptr; }
+    bool           restructured()  const { return restructured_; }
+    const uint8_t* dirty()         const { return dirty_; }
+    uint64_t       n_blocks()      const { return dirtyStore_.size(); }
+    uint64_t       count_dirty()   const;
+    void           clear_dirty();
+
+    /* copy-on-write snapshot (see the file comment); keep, one byte per
+       block, limits it to the blocks that are set (nullptr → all). The
+       store must not be restructured until thaw(), which is called
+       between passes once reading is done. read_frozen() copies
+       elements [first, first+n) of array a (arrays() order), first on
+       a block boundary, to stage – each frozen block is read once –
+       and returns the bytes; arrays that never change are returned in
+       place                                                           */
+    void           freeze(const uint8_t* keep = nullptr);
+    void           thaw();
+    bool           frozen() const { return frozen_.state != nullptr; }
+    const uint8_t* read_frozen(int a, uint64_t first, uint64_t n,
+                               std::vector<uint8_t>& stage) const;
+
+    /* SoA weight array in its storage format (I/O) */
+    void* weights() const;
+
+    /* owned arrays as {base, bytes per synapse, page bytes}; empty
+       when attached to a Metal buffer                                */
+    struct Array { void* p; uint32_t elemBytes; uint64_t pageBytes; };
+    std::vector<Array> arrays() const;
+
+    /* element access, layout-agnostic (cold paths only) */
+    SynapsePacked get(uint64_t i) const
+    {
+        if(layout_==SynapseLayout::Packed) return pk_[i];
+        return { src_[i], dst_[i], weight(i), 0.f };
+    }
+    void set(uint64_t i, const SynapsePacked& s)
+    {
+        restructured_ = true;
+        if(layout_==SynapseLayout::Packed){ pk_[i] = s; return; }
+        src_[i] = s.src; dst_[i] = s.dst; set_weight(i, s.w, kRoundNearest);
+    }
+    uint32_t src(uint64_t i) const
+    {
+        return layout_==SynapseLayout::Packed ? pk_[i].src : src_[i];
+    }
+    void swap(uint64_t i, uint64_t j)
+    {
+        restructured_ = true;
+        if(layout_==SynapseLayout::Packed){ std::swap(pk_[i], pk_[j]); return; }
+        std::swap(src_[i], src_[j]); std::swap(dst_[i], dst_[j]);
+        switch(wfmt_){
+            case WeightFormat::F32: std::swap(w_[i],   w_[j]);   break;
+            case WeightFormat::U8:  std::swap(w8_[i],  w8_[j]);  break;
+            default:                std::swap(w16_[i], w16_[j]); break;
+        }
+    }
+
+    /* structural plasticity (see the file comment): prune() frees the
+       live synapses of [first, first+n) with a weight below wPrune and
+       returns how many; compact() moves the live ones to the front of
+       the range in order, frees the rest and returns the live count;
+       move() copies n synapses from → to (any overlap)               */
+    bool     is_free(uint64_t i) const { return src(i)==kFreeSyn; }
+    uint64_t prune(uint64_t first, uint64_t n, float wPrune);
+    uint64_t compact(uint64_t first, uint64_t n);
+    void     move(uint64_t to, uint64_t from, uint64_t n);
+    void     free_range(uint64_t first, uint64_t n);
+    void     mark_restructured() { restructured_ = true; }
+
+    /* SoA weights, decoded / encoded with rounding bits r */
+    float weight(uint64_t i) const;
+    void  set_weight(uint64_t i, float w, uint32_t r);
+
+    /* bulk conversion of [first, first+n) to / from packed records */
+    void from_packed(const SynapsePacked* in, uint64_t first, uint64_t n);
+    void to_packed  (SynapsePacked* out,      uint64_t first, uint64_t n) const;
+
+private:
+    void release();
+
+    SynapseLayout layout_{SynapseLayout::Packed};
+    WeightFormat  wfmt_  {WeightFormat::F32};
+    float         wLo_{0.f}, wHi_{1.f};
+    uint64_t      n_{0};
+    bool          external_{false};
+    bool          restructured_{true};
+    HostPages     wantPages_{HostPages::Base};
+    uint64_t      wantCap_{0};
+
+    /* views */
+    SynapsePacked* pk_ {nullptr};
+    uint32_t*      src_{nullptr};
+    uint32_t*      dst_{nullptr};
+    float*         w_  {nullptr};
+    uint16_t*      w16_{nullptr};
+    uint8_t*       w8_ {nullptr};
+    uint8_t*       dirty_{nullptr};
+
+    /* owned storage: anonymous arrays or a mapped file */
+    std::unique_ptr<MappedFile> file_;
+    HostArray<SynapsePacked> pkStore_;
+    HostArray<uint32_t>      srcStore_, dstStore_;
+    HostArray<float>         wStore_;
+    HostArray<uint16_t>      w16Store_;
+    HostArray<uint8_t>       w8Store_;
+    HostArray<uint8_t>       dirtyStore_;
+
+    /* snapshot in progress: block states + shadow weights */
+    FrozenWeights            frozen_{};
+    HostArray<uint8_t>       frozenStore_, shadowStore_;
+};
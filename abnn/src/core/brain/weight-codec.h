@@ -0,0 +1,90 @@
+#pragma once
+/* weight-codec.h  –  storage formats for synaptic weights
+ * ====================================================================
+ * * F32  : plain float (the only format the packed / Metal layout has)
+ * * F16  : IEEE binary16
+ * * BF16 : upper half of a float
+ * * U8   : fixed point over [lo, hi], w = lo + q·(hi-lo)/255
+ * * Every encoder takes 32 random bits r and rounds stochastically:
+ *   F16 adds r>>19 below the 10-bit mantissa, BF16 adds r>>16 below the
+ *   7-bit mantissa, U8 adds (r>>8)·2⁻²⁴ before truncating; the result is
+ *   then truncated toward zero. r = kRoundNearest gives plain rounding
+ * * The SIMD kernels use the same arithmetic (cvtps_ph with round-to-
+ *   zero), so scalar and vector paths round the same way
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+enum class WeightFormat : uint32_t { F32 = 0, F16 = 1, BF16 = 2, U8 = 3 };
+
+static constexpr uint32_t kRoundNearest = 0x80000000u;
+
+inline const char* weight_format_name(WeightFormat f)
+{
+    switch(f){
+        case WeightFormat::F16:  return "fp16";
+        case WeightFormat::BF16: return "bf16";
+        case WeightFormat::U8:   return "u8";
+        default:                 return "f32";
+    }
+}
+
+inline uint32_t weight_bytes(WeightFormat f)
+{
+    switch(f){
+        case WeightFormat::F16:
+        case WeightFormat::BF16: return 2;
+        case WeightFormat::U8:   return 1;
+        default:                 return 4;
+    }
+}
+
+/* bit casts ------------------------------------------------------------ */
+inline uint32_t f32_bits(float x)    { uint32_t b; std::memcpy(&b,&x,4); return b; }
+inline float    bits_f32(uint32_t b) { float x;    std::memcpy(&x,&b,4); return x; }
+
+/* ===================================================================== */
+/* binary16                                                              */
+inline uint16_t encode_f16(float x, uint32_t r)
+{
+    const uint32_t b    = f32_bits(x);
+    const uint16_t sign = uint16_t((b>>16) & 0x8000u);
+    const uint32_t a    = (b & 0x7FFFFFFFu) + (r>>19);
+
+    if(a >= 0x477FF000u) return sign | 0x7BFFu;              /* ≥ max → max   */
+    if(a >= 0x38800000u) return sign | uint16_t((a-0x38000000u)>>13);
+
+    const uint32_t e = a>>23;                                /* subnormal     */
+    if(e < 102) return sign;
+    return sign | uint16_t(((a & 0x7FFFFFu) | 0x800000u) >> (126-e));
+}
+
+inline float decode_f16(uint16_t h)
+{
+    const uint32_t sign = uint32_t(h & 0x8000u) << 16;
+    const uint32_t e    = (h>>10) & 0x1Fu, m = h & 0x3FFu;
+    if(e==0)  return bits_f32(sign | f32_bits(float(m) * (1.0f/16777216.0f)));
+    if(e==31) return bits_f32(sign | 0x7F800000u | (m<<13));
+    return bits_f32(sign | ((e+112)<<23) | (m<<13));
+}
+
+/* ===================================================================== */
+/* bfloat16                                                              */
+inline uint16_t encode_bf16(float x, uint32_t r)
+{
+    return uint16_t((f32_bits(x) + (r>>16)) >> 16);
+}
+
+inline float decode_bf16(uint16_t h) { return bits_f32(uint32_t(h)<<16); }
+
+/* ===================================================================== */
+/* 8-bit fixed point, invStep = 255/(hi-lo)                              */
+inline uint8_t encode_u8(float w, float lo, float invStep, uint32_t r)
+{
+    float q = (w-lo)*invStep + float(r>>8) * (1.0f/16777216.0f);
+    return uint8_t(std::min(255.f, std::max(0.f, q)));
+}
+
+inline float decode_u8(uint8_t q, float lo, float step) { return lo + float(q)*step; }
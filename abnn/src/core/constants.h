@@ -9,6 +9,40 @@
 #define INPUT_RATE_HZ 1000
 #define PEAK_DECAY 0.999f         // how quickly old peaks fade
 #define EVENTS_PER_PASS 150'000'000
+#define RNG_SEED 1                // Philox key for synapse draws, inputs, teacher; 0 = random_device
+#define CPU_THREADS 0             // CPU backend workers, 0 = all cores
+#define CPU_SIMD -1               // -1 = best available, 0 scalar, 1 AVX2, 2 AVX-512
+#define CPU_SYNAPSE_LAYOUT 0      // 0 = packed {src,dst,w,pad}, 1 = SoA src[]/dst[]/w[]
+#define CPU_WEIGHT_FORMAT 0       // 0 = f32, 1 = fp16, 2 = bf16, 3 = u8 over [_wMin,_wMax] (1-3 imply SoA)
+#define CPU_ACTIVE_SET 0          // 1 = visit only out-rows of recently fired neurons (CSR)
+#define CPU_DETERMINISTIC 0       // 1 = bit-identical runs for any CPU_THREADS (snapshot gating)
+#define CPU_SPIKE_BITMAP 1        // 1 = gate WINDOW_PRE on a 1-bit/neuron bitmap before lastFired
+#define CPU_NUMA 0                // 1 = pin workers to NUMA nodes, bind synapse shards to their node
+#define CPU_MMAP_LOAD 0           // .bnn load: 0 = read into memory, 1 = mmap copy-on-write, 2 = mmap shared (in-place)
+#define BNN_DELTA_MAX 8           // save_model: delta checkpoints (changed weight blocks only) before a full rewrite, 0 = always full
+#define BNN_DELTA_DIRTY 0.5       // above this fraction of changed weight blocks save_model writes the full file
+#define GRAPH_TOPOLOGY 0          // new graph: 0 random, 1 small-world (Watts–Strogatz), 2 scale-free (Barabási–Albert), 3/4 distance 2-D/3-D
+#define GRAPH_WS_BETA 0.1f        // small-world rewiring probability
+#define GRAPH_SIGMA 8.0f          // distance topologies: target offset std-dev in grid cells per axis
+#define INH_FRACTION 0            // CPU: share of hidden neurons that are inhibitory (E/I, e.g. 0.2), 0 = all excitatory
+#define GRAPH_SAVE 0              // save model.bnn right after building a new graph (rebuilt identically for RNG_SEED ≠ 0)
+#define REWIRE_EVERY 0            // CPU: prune / grow synapses every N passes, 0 = fixed graph
+#define SYN_PRUNE_W 0.01f         // rewire: synapses with a weight below this are freed
+#define SYN_NEW_P 0.001f          // rewire: chance a neuron that fired last pass grows one synapse
+#define SYN_INIT_W 0.1f           // rewire: weight of a new synapse
+#define SYN_COMPACT_FRAC 0.25f    // rewire: compact once free slots exceed this share of the span
+#define HIDDEN_RESERVE 0          // CPU: hidden neurons of address space reserved for online growth, 0 = fixed size
+#define SYN_RESERVE 0             // CPU: synapse slots reserved likewise
+#define GROW_EVERY 0              // CPU: append GROW_NEURONS hidden neurons every N passes, 0 = never
+#define GROW_NEURONS 100'000      // grow: neurons per step
+#define GROW_DEGREE 16            // grow: out- and in-synapses of each new neuron (2·degree slots)
+#define CKPT_EVERY_SEC 0          // headless: background checkpoint every N s while running, 0 = only on exit
+#define BNN_COMPRESS 0            // .bnn synapse sections: 0 = raw (mappable), 1 = block codec (smaller, never mapped)
+#define CPU_HUGE_PAGES 1          // synapse/timestamp pages: 0 = 4 KB, 1 = THP, 2 = 2 MB hugetlb, 3 = 1 GB (falls back)
+#define NEURON_ORDER 0            // relabel hidden neurons on build/load: 0 off, 1 degree, 2 RCM
+#define PASS_BATCH 16             // CPU passes fused per Brain::run_passes() in the engine loop (≥ 1)
+#define PIPE_DEPTH 64             // engine pipeline queue slots (stimulus frames / readout batches, ≥ 1)
+#define PIPE_REWARD_LAG 64        // max passes the simulator runs ahead of readout (reward latency, ≥ 1)
 #define FILTER_TAU 0.02
 #define USE_FIR true
 #define dT_SEC 0.0009
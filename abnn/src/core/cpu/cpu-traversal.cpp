@@ -0,0 +1,359 @@
+// cpu-traversal.cpp  –  CPU port of monte_carlo_traversal
+// ======================================================================
+
+#include "cpu-traversal.h"
+#include "numa.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <iostream>
+#include <vector>
+
+/* ===================================================================== */
+CpuTraversal::CpuTraversal(uint32_t nThreads, int simd)
+: pool_(nThreads)
+{
+    SimdLevel best = detect_simd_level();
+    simd_   = simd < 0 ? best : SimdLevel(std::min(simd, int(best)));
+    for(int k=0;k<kSynapseKinds;++k){
+        kernel_[0][k] = select_kernel(simd_, SynapseLayout::Packed, SynapseKind(k));
+        kernel_[1][k] = select_kernel(simd_, SynapseLayout::SoA,    SynapseKind(k));
+    }
+
+    /* counters attach to the thread that opens them */
+    for(auto& p : perf_) p = std::vector<PerfCounter>(pool_.size());
+    pool_.run([&](uint32_t w){
+        perf_[0][w].open(PerfEvent::CacheMisses);
+        perf_[1][w].open(PerfEvent::DtlbMisses);
+    });
+
+    std::cout<<"🧵 CPU backend: "<<pool_.size()<<" threads, "
+             <<simd_level_name(simd_)<<" kernel"
+             <<(perf_[0][0].valid() ? ", cache-miss counters" : "")
+             <<(perf_[1][0].valid() ? ", dTLB counters" : "")<<"\n";
+}
+
+/* ===================================================================== */
+TraversalStats CpuTraversal::run(const TraversalState& st,
+                                 const PlasticityParams& pp)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    const uint64_t miss0 = perf_total(PerfEvent::CacheMisses);
+    const uint64_t tlb0  = perf_total(PerfEvent::DtlbMisses);
+
+    /* worker 0 is whichever thread calls run(): pin it on first sight */
+    if(numa_ && pinned_ != std::this_thread::get_id()){
+        numa_pin_thread(node_of(0));
+        pinned_ = std::this_thread::get_id();
+    }
+
+    budget_.reset(kMaxSpikes, pool_.size());
+
+    const uint32_t now  = *st.clock;
+    const float    R    = *st.reward;
+    const float    rBar = *st.rBar;
+
+    if(spikeBitmap_ || st.types) build_bitmaps(st, now);
+    uint32_t* recent = spikeBitmap_ ? recent_.data() : nullptr;
+    uint32_t* quiet  = st.types     ? quiet_.data()  : nullptr;
+
+    const PassContext ctx{ st.syn, st.lastF, recent, st.lastI, quiet, now, st.pass, st.key,
+                           R, rBar, pp, &budget_, 0, nullptr };
+
+    /* i32 gathers index lastFired with signed offsets */
+    const bool  soa  = st.syn.layout==SynapseLayout::SoA;
+    const bool  wide = st.nNrn <= uint32_t(INT_MAX);
+    RangeKernel kernel[kSynapseKinds];
+    for(int k=0;k<kSynapseKinds;++k)
+        kernel[k] = wide ? kernel_[soa][k] : select_kernel(SimdLevel::Scalar, st.syn.layout, SynapseKind(k));
+
+    ws_.assign(pool_.size(), WorkerStats{0,0,0,0});
+
+    TraversalStats out;
+    uint64_t total = st.nSyn;
+    inhEnd_ = 0;
+    if(st.rowPtr){
+        total      = collect_active(st, now);
+        out.active = rows_.size();
+    } else if(st.types){
+        total      = collect_runs(st);
+    }
+    out.span = total;
+
+    if(deterministic_){
+        run_deterministic(st, ctx, kernel, total);
+    } else {
+        pool_.parallel_for(total, [&](uint64_t b, uint64_t e, uint32_t w)
+        {
+            PassContext wc = ctx;
+            wc.worker = w;
+
+            /* early out: once the budget is spent for this worker every
+               later excitatory synapse would be skipped by the gate.
+               Inhibitory positions take no tokens, so the inhibitory
+               prefix is always scanned to its end                      */
+            uint64_t gated=0, fired=0, inhibited=0, pos=b;
+            while(pos<e && (pos<inhEnd_ || !budget_.exhausted(w))){
+                uint64_t end = std::min(e, pos+kStopChunk);
+                if(pos<inhEnd_) end = std::min(end, inhEnd_);
+                RangeCounts rc = run_positions(st, wc, kernel, pos, end);
+                gated += rc.gated; fired += rc.fired; inhibited += rc.inhibited;
+                pos    = end;
+            }
+            ws_[w] = { pos-b, gated, fired, inhibited };
+        });
+    }
+
+    /* EWMA reward baseline + clock: once per pass (tid 0 on the GPU) -- */
+    if(st.nSyn){
+        *st.rBar  = rBar + kAlphaRBar * (R - rBar);
+        *st.clock = now + kClockInc;
+    }
+
+    /* bytes each worker streamed: the scan array per visited synapse,
+       SoA adds dst + weight for gated ones                           */
+    const uint64_t scanB  = soa ? 4 : sizeof(SynapsePacked);
+    const uint64_t gatedB = soa ? 4 + weight_bytes(st.syn.wfmt) : 0;
+    for(uint32_t w=0; w<ws_.size(); ++w){
+        const WorkerStats& s = ws_[w];
+        out.visited+=s.visited; out.gated+=s.gated; out.fired+=s.fired;
+        out.inhibited+=s.inhibited;
+        out.nodeBytes[std::min(node_of(w), kStatsNodes-1)] += s.visited*scanB + s.gated*gatedB;
+    }
+    out.saturated   = out.fired >= kMaxSpikes;
+    out.cacheMisses = perf_total(PerfEvent::CacheMisses) - miss0;
+    out.tlbMisses   = perf_total(PerfEvent::DtlbMisses)  - tlb0;
+    out.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+    return out;
+}
+
+/* ===================================================================== */
+/* recent-spike / quiet bitmaps: 32 neurons per word, sharded on word
+   boundaries                                                            */
+void CpuTraversal::build_bitmaps(const TraversalState& st, uint32_t now)
+{
+    const uint64_t nWords = (uint64_t(st.nNrn) + 31) / 32;
+    if(spikeBitmap_) recent_.resize(nWords);
+    if(st.lastI)     quiet_.resize(nWords);
+
+    /* no pass is running, so plain lastF / lastI reads vectorise */
+    pool_.parallel_for(nWords, [&](uint64_t b, uint64_t e, uint32_t)
+    {
+        for(uint64_t k=b; k<e; ++k){
+            const uint64_t n0 = k*32;
+            const uint32_t m  = uint32_t(std::min<uint64_t>(32, st.nNrn - n0));
+            if(spikeBitmap_){
+                uint32_t bits = 0;
+                for(uint32_t j=0; j<m; ++j)
+                    bits |= uint32_t(now - st.lastF[n0+j] <= kWindowPre) << j;
+                recent_[k] = bits;
+            }
+            if(st.lastI){
+                uint32_t bits = 0;
+                for(uint32_t j=0; j<m; ++j)
+                    bits |= uint32_t(now - st.lastI[n0+j] <= kInhibit) << j;
+                quiet_[k] = bits;
+            }
+        }
+    });
+}
+
+/* ===================================================================== */
+uint32_t CpuTraversal::node_of(uint32_t w) const
+{
+    return uint32_t(uint64_t(w) * numa_topology().n_nodes() / pool_.size());
+}
+
+void CpuTraversal::set_numa(bool on)
+{
+    numa_ = on;
+    const uint32_t nNodes = numa_topology().n_nodes();
+    if(!on || nNodes < 2){ pinned_ = {}; return; }
+
+    pool_.run([&](uint32_t w){ numa_pin_thread(node_of(w)); });
+    pinned_ = std::this_thread::get_id();
+    std::cout<<"🧭 NUMA: "<<nNodes<<" nodes, "<<pool_.size()<<" workers pinned\n";
+}
+
+void CpuTraversal::place_synapses(const std::vector<SynapseStore::Array>& arrays,
+                                  uint64_t nSyn, uint64_t nTotal, bool sharded) const
+{
+    if(!numa_ || numa_topology().n_nodes() < 2) return;
+
+    const uint64_t T = pool_.size();
+    for(const auto& a : arrays){
+        char* base = static_cast<char*>(a.p);
+        if(!base) continue;
+        if(!sharded){ numa_interleave(base, nTotal*a.elemBytes, a.pageBytes); continue; }
+
+        /* the parallel_for split of the dense pass */
+        for(uint32_t w=0; w<T; ++w){
+            const uint64_t b = nSyn*w/T, e = nSyn*(w+1)/T;
+            numa_bind(base + b*a.elemBytes, (e-b)*a.elemBytes, node_of(w), a.pageBytes);
+        }
+        if(nTotal > nSyn)
+            numa_interleave(base + nSyn*a.elemBytes, (nTotal-nSyn)*a.elemBytes, a.pageBytes);
+    }
+}
+
+void CpuTraversal::place_shared(void* p, uint64_t bytes, uint64_t page) const
+{
+    if(numa_ && p) numa_interleave(p, bytes, page);
+}
+
+uint64_t CpuTraversal::perf_total(PerfEvent ev) const
+{
+    uint64_t n = 0;
+    for(auto& p : perf_[uint32_t(ev)]) n += p.read();
+    return n;
+}
+
+/* ===================================================================== */
+/* event-driven pass: sources that fired within WINDOW_PRE ticks         */
+uint64_t CpuTraversal::collect_active(const TraversalState& st, uint32_t now)
+{
+    const uint64_t* rowPtr = st.rowPtr;
+
+    /* ---------- 1. active sources, one list per neuron shard --------- */
+    localRows_.resize(pool_.size());
+    pool_.parallel_for(spikeBitmap_ ? recent_.size() : st.nNrn, [&](uint64_t b, uint64_t e, uint32_t w)
+    {
+        auto& rows = localRows_[w];
+        rows.clear();
+        if(spikeBitmap_){
+            /* b,e index bitmap words here */
+            for(uint64_t k=b; k<e; ++k)
+                for(uint32_t bits=recent_[k]; bits; bits&=bits-1){
+                    const uint64_t n = k*32 + __builtin_ctz(bits);
+                    if(rowPtr[n+1] > rowPtr[n]) rows.push_back(uint32_t(n));
+                }
+            return;
+        }
+        for(uint64_t n=b; n<e; ++n){
+            uint32_t lp = std::atomic_ref<uint32_t>(st.lastF[n])
+                              .load(std::memory_order_relaxed);
+            if(now - lp <= kWindowPre && rowPtr[n+1] > rowPtr[n])
+                rows.push_back(uint32_t(n));
+        }
+    });
+
+    /* ---------- 2. concatenate (shards are ascending) + prefix sizes - */
+    /* E/I: the rows of inhibitory sources go first                    */
+    rows_.clear();
+    rowOff_.assign(1, 0);
+    for(int inh = st.types ? 1 : 0; inh >= 0; --inh){
+        for(auto& rows : localRows_)
+            for(uint32_t n : rows){
+                if(st.types && (st.types[n]==NeuronType::Inh) != bool(inh)) continue;
+                rows_.push_back(n);
+                rowOff_.push_back(rowOff_.back() + rowPtr[n+1] - rowPtr[n]);
+            }
+        if(inh) inhEnd_ = std::min(rowOff_.back(), st.nSyn);
+    }
+
+    /* same per-pass cap as the dense scan */
+    return std::min(rowOff_.back(), st.nSyn);
+}
+
+/* ===================================================================== */
+/* E/I dense pass: the type runs, inhibitory ones first                  */
+uint64_t CpuTraversal::collect_runs(const TraversalState& st)
+{
+    segs_.clear();
+    segOff_.assign(1, 0);
+    for(int inh=1; inh>=0; --inh){
+        for(uint32_t r=0; r<st.nRuns; ++r){
+            const TypeRun& t = st.runs[r];
+            if((t.type==NeuronType::Inh) != bool(inh) || t.end <= t.first) continue;
+            segs_.push_back({ t.first, synapse_kind(t.type) });
+            segOff_.push_back(segOff_.back() + t.end - t.first);
+        }
+        if(inh) inhEnd_ = std::min(segOff_.back(), st.nSyn);
+    }
+    return std::min(segOff_.back(), st.nSyn);
+}
+
+/* ===================================================================== */
+RangeCounts CpuTraversal::run_positions(const TraversalState& st,
+                                        const PassContext& ctx, const RangeKernel* kernel,
+                                        uint64_t b, uint64_t e) const
+{
+    if(!st.rowPtr && !st.types) return kernel[int(SynapseKind::Plain)](ctx, b, e);
+
+    /* ---------- split the concatenated rows / runs at b --------------- */
+    const std::vector<uint64_t>& off = st.rowPtr ? rowOff_ : segOff_;
+    uint64_t gated=0, fired=0, inhibited=0;
+    size_t   r = std::upper_bound(off.begin(), off.end(), b) - off.begin() - 1;
+
+    for(uint64_t pos=b; pos<e; ++r){
+        uint64_t    first;
+        SynapseKind kind;
+        if(st.rowPtr){
+            first = st.rowPtr[rows_[r]];
+            kind  = st.types ? synapse_kind(st.types[rows_[r]]) : SynapseKind::Plain;
+        } else {
+            first = segs_[r].first;
+            kind  = segs_[r].kind;
+        }
+        first += pos - off[r];
+        const uint64_t n = std::min(off[r+1], e) - pos;
+        RangeCounts rc = kernel[int(kind)](ctx, first, first+n);
+        gated += rc.gated; fired += rc.fired; inhibited += rc.inhibited;
+        pos   += n;
+    }
+    return { gated, fired, inhibited };
+}
+
+/* ===================================================================== */
+/* deterministic pass: scan slices, prefix-sum the budget, commit slices */
+void CpuTraversal::run_deterministic(const TraversalState& st, const PassContext& ctx,
+                                     const RangeKernel* kernel, uint64_t total)
+{
+    const uint64_t nChunk = (total + kDetChunk - 1) / kDetChunk;
+    if(chunks_.size() < nChunk) chunks_.resize(nChunk);
+
+    /* ---------- 1. scan: candidates per slice, nothing written ------- */
+    pool_.parallel_for(nChunk, [&](uint64_t cb, uint64_t ce, uint32_t)
+    {
+        for(uint64_t c=cb; c<ce; ++c){
+            DetChunk& ch = chunks_[c];
+            ch.cand.clear();
+            PassContext sc = ctx;
+            sc.cand = &ch.cand;
+            ch.want = run_positions(st, sc, kernel,
+                                    c*kDetChunk, std::min(total, (c+1)*kDetChunk)).fired;
+        }
+    });
+
+    /* ---------- 2. budget in slice order ----------------------------- */
+    uint64_t used = 0;
+    for(uint64_t c=0; c<nChunk; ++c){
+        chunks_[c].budget = used < kMaxSpikes ? uint32_t(kMaxSpikes - used) : 0u;
+        used += chunks_[c].want;
+    }
+
+    /* ---------- 3. commit: weights + spikes, slices are disjoint ----- */
+    pool_.parallel_for(nChunk, [&](uint64_t cb, uint64_t ce, uint32_t w)
+    {
+        uint64_t gated=0, fired=0, inhibited=0;
+        for(uint64_t c=cb; c<ce; ++c){
+            const DetChunk& ch = chunks_[c];
+            RangeCounts rc = commit_candidates(ctx, ch.cand.data(), ch.cand.size(), ch.budget);
+            gated += rc.gated; fired += rc.fired; inhibited += rc.inhibited;
+        }
+        ws_[w] = { std::min(total, ce*kDetChunk) - std::min(total, cb*kDetChunk),
+                   gated, fired, inhibited };
+    });
+}
+
+/* ===================================================================== */
+void CpuTraversal::renormalise(const TraversalState& st)
+{
+    const uint32_t base = *st.clock;
+    pool_.parallel_for(st.nNrn, [&](uint64_t b, uint64_t e, uint32_t){
+        for(uint64_t i=b; i<e; ++i) st.lastF[i] -= base;
+        if(st.lastI) for(uint64_t i=b; i<e; ++i) st.lastI[i] -= base;
+    });
+    *st.clock = 0;
+}
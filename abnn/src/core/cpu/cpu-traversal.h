@@ -0,0 +1,205 @@
+#pragma once
+/* cpu-traversal.h  –  CPU port of monte_carlo_traversal
+ * =====================================================================
+ * * Shards the synapse array across a persistent ThreadPool
+ * * Same gating (WINDOW_PRE / REFRACTORY / budget), STDP, reward and
+ *   homeostasis terms as brain.metal; one clock tick per pass
+ * * The per-pass spike cap is a SpikeBudget: workers spend tokens from
+ *   private blocks and only touch shared state to refill or steal
+ * * Shards run the widest RangeKernel the CPU supports (AVX-512, AVX2,
+ *   scalar), see traversal-kernels.h
+ * * With a source index (TraversalState::rowPtr) the pass is
+ *   event-driven: it first collects the neurons that fired within
+ *   WINDOW_PRE ticks and then visits only their outgoing CSR rows, so
+ *   the work scales with spike activity instead of N_SYN
+ * * Each pass starts by condensing lastFired into a 1-bit-per-neuron
+ *   "fired within WINDOW_PRE" bitmap (N/8 bytes, L2-resident for a few
+ *   million neurons); the kernels gate on it before any lastFired
+ *   gather and the active-set collection scans it instead of lastFired
+ * * A worker stops scanning as soon as no spike token is left for it:
+ *   every later synapse would fail the budget gate anyway, so the rest
+ *   of its shard is skipped and only `visited` of `span` are loaded
+ * * Deterministic mode gives bit-identical results for any thread
+ *   count: the visited range is cut into fixed kDetChunk slices that
+ *   are scanned in parallel without writes, the spike budget is handed
+ *   out by a prefix sum over the slices, and each slice then commits
+ *   its own candidates. Gating sees lastFired as of the pass start
+ * * E/I (TraversalState::types set): every range runs the kernel of its
+ *   sources' type, picked once per range. Dense passes visit the slot
+ *   runs of inhibitory sources first, active-set passes their rows, so
+ *   inhibition already gates the spikes of the same pass; a pass also
+ *   condenses lastInhibit into a "hit within kInhibit" bitmap that the
+ *   excitatory kernel tests before a target may fire
+ * * NUMA (opt-in): worker w is pinned to node w·nodes/threads and each
+ *   dense shard's synapse pages are bound to its worker's node, so the
+ *   streaming scan reads local memory; lastFired / lastVisit are
+ *   gathered at random and are interleaved over all nodes instead
+ * * The pass works on raw views into memory owned by Brain, so it runs
+ *   equally on host vectors (Linux) and on shared Metal buffers (macOS)
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "brain-types.h"
+#include "thread-pool.h"
+#include "perf-counter.h"
+#include "traversal-kernels.h"
+
+/* views into Brain-owned state ----------------------------------------- */
+struct TraversalState
+{
+    SynapseView    syn;
+    uint64_t       nSyn;          /* synapses visited per pass (cap)      */
+    const uint64_t* rowPtr;       /* CSR offsets by src, nullptr → dense  */
+    uint32_t*      lastF;
+    uint32_t       nNrn;
+    uint32_t*      clock;
+    const float*   reward;
+    float*         rBar;
+    uint64_t       pass;          /* passes run so far (Philox counter)   */
+    PhiloxKey      key;
+
+    /* E/I, all nullptr → homogeneous network */
+    const NeuronType* types;      /* per neuron                           */
+    const TypeRun* runs;          /* dense: slots by source type, in order */
+    uint32_t       nRuns;
+    uint32_t*      lastI;         /* last inhibitory hit per neuron       */
+};
+
+/* per-pass counters ---------------------------------------------------- */
+static constexpr uint32_t kStatsNodes = 8;   /* nodes beyond share the last */
+
+struct TraversalStats
+{
+    uint64_t active {0};          /* presynaptic neurons in the active set */
+    uint64_t span   {0};          /* synapses the pass could visit        */
+    uint64_t visited{0};          /* synapses loaded (≤ span)             */
+    uint64_t gated  {0};          /* passed WINDOW_PRE/REFRACTORY/budget  */
+    uint64_t fired  {0};          /* spikes committed                     */
+    uint64_t inhibited{0};        /* inhibitory hits committed (E/I)      */
+    uint64_t saturated{0};        /* passes that spent the whole budget   */
+    uint64_t cacheMisses{0};      /* HW counter, 0 when unavailable       */
+    uint64_t tlbMisses  {0};      /* dTLB load misses, same               */
+    uint64_t nodeBytes[kStatsNodes]{};  /* synapse bytes streamed by the
+                                           workers of each NUMA node     */
+    double   seconds{0.0};        /* wall time of the pass                */
+
+    TraversalStats& operator+=(const TraversalStats& o)
+    {
+        active += o.active;  span += o.span;   visited += o.visited;
+        gated  += o.gated;   fired += o.fired; cacheMisses += o.cacheMisses;
+        inhibited += o.inhibited; saturated += o.saturated;
+        tlbMisses += o.tlbMisses;
+        for(uint32_t k=0;k<kStatsNodes;++k) nodeBytes[k] += o.nodeBytes[k];
+        seconds += o.seconds;
+        return *this;
+    }
+};
+
+/* ===================================================================== */
+class CpuTraversal
+{
+public:
+    /* simd < 0 → best available, otherwise capped at that SimdLevel */
+    explicit CpuTraversal(uint32_t nThreads = 0, int simd = -1);
+
+    /* one Monte-Carlo pass; advances *clock by CLOCK_INC */
+    TraversalStats run(const TraversalState&, const PlasticityParams&);
+
+    /* subtract clock from every timestamp and reset the clock */
+    void renormalise(const TraversalState&);
+
+    /* thread-count independent passes (snapshot gating, prefix budget) */
+    void set_deterministic(bool on) { deterministic_ = on; }
+    bool deterministic() const      { return deterministic_; }
+
+    /* WINDOW_PRE prefilter bitmap (on by default, exact either way) */
+    void set_spike_bitmap(bool on)  { spikeBitmap_ = on; }
+    bool spike_bitmap() const       { return spikeBitmap_; }
+
+    /* pin workers to NUMA nodes (no-op on a single node) */
+    void set_numa(bool on);
+    bool numa() const { return numa_; }
+
+    /* bind the dense shards [0,nSyn) of each array to their workers'
+       nodes (sharded) or interleave them (active set: rows are visited
+       in spike order); synapses past nSyn are interleaved            */
+    void place_synapses(const std::vector<SynapseStore::Array>&,
+                        uint64_t nSyn, uint64_t nTotal, bool sharded) const;
+    /* randomly gathered per-neuron state: interleave */
+    void place_shared(void* p, uint64_t bytes, uint64_t page = 0) const;
+
+    uint32_t    n_threads()  const { return pool_.size(); }
+    SimdLevel   simd_level() const { return simd_; }
+    ThreadPool& pool()             { return pool_; }
+
+private:
+    /* one cache line per worker so the counters never share a line */
+    struct alignas(64) WorkerStats { uint64_t visited, gated, fired, inhibited; };
+
+    /* one deterministic slice: scan output + budget share */
+    struct DetChunk
+    {
+        std::vector<Candidate> cand;
+        uint64_t               want;
+        uint32_t               budget;
+    };
+    static constexpr uint64_t kDetChunk  = 1u<<16;  /* positions / slice */
+    static constexpr uint64_t kStopChunk = 1u<<14;  /* budget poll step  */
+
+    /* bit n of recent_ ⇔ now - lastF[n] <= WINDOW_PRE (spike bitmap),
+       bit n of quiet_  ⇔ now - lastI[n] <= kInhibit   (E/I)          */
+    void build_bitmaps(const TraversalState&, uint32_t now);
+
+    /* E/I dense pass: the slot runs as segs_/segOff_, inhibitory first;
+       returns the positions they cover, capped at st.nSyn             */
+    uint64_t collect_runs(const TraversalState&);
+
+    /* summed over the workers' counters */
+    uint64_t perf_total(PerfEvent) const;
+
+    /* NUMA node of worker w: contiguous worker blocks per node */
+    uint32_t node_of(uint32_t w) const;
+
+    /* collect active sources into rows_/rowOff_; returns the number of
+       positions (synapses) their rows cover, capped at st.nSyn       */
+    uint64_t collect_active(const TraversalState&, uint32_t now);
+
+    /* run the kernels (by SynapseKind) over positions [b,e): synapse
+       indices when dense, offsets into the concatenated active rows or
+       type runs otherwise                                            */
+    RangeCounts run_positions(const TraversalState&, const PassContext&,
+                              const RangeKernel*, uint64_t b, uint64_t e) const;
+
+    void run_deterministic(const TraversalState&, const PassContext&,
+                           const RangeKernel*, uint64_t total);
+
+    ThreadPool            pool_;
+    SimdLevel             simd_;
+    RangeKernel           kernel_[2][kSynapseKinds];  /* by SynapseLayout, kind */
+    SpikeBudget           budget_;
+    std::vector<WorkerStats> ws_;
+    bool                  deterministic_{false};
+    bool                  spikeBitmap_{true};
+    bool                  numa_{false};
+    std::thread::id       pinned_;                  /* worker 0 = caller */
+    std::vector<uint32_t> recent_, quiet_;
+    std::vector<PerfCounter> perf_[2];              /* by PerfEvent, one per worker */
+    std::vector<DetChunk> chunks_;
+
+    /* active-set scratch, reused across passes */
+    std::vector<std::vector<uint32_t>> localRows_;  /* per worker      */
+    std::vector<uint32_t>              rows_;       /* active sources  */
+    std::vector<uint64_t>              rowOff_;     /* prefix of sizes */
+
+    /* E/I dense scratch: slot runs in visiting order */
+    struct Segment { uint64_t first; SynapseKind kind; };
+    std::vector<Segment>               segs_;
+    std::vector<uint64_t>              segOff_;     /* prefix of sizes */
+
+    /* E/I: positions [0, inhEnd_) are inhibitory rows / runs, which
+       spend no budget and are never cut short                        */
+    uint64_t                           inhEnd_{0};
+};
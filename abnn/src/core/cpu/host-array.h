@@ -0,0 +1,196 @@
+#pragma once
+/* host-array.h  –  page-aligned, zero-filled host allocation
+ * =====================================================================
+ * * Anonymous mmap instead of std::vector: the pages are zero and not
+ *   touched until first use, so a placement policy set on the range
+ *   (numa.h) decides where each page lands
+ * * Optional huge pages: 1 GB / 2 MB hugetlbfs (MAP_HUGETLB, needs a
+ *   reserved pool) or transparent 2 MB pages (madvise). A request that
+ *   cannot be met falls back 1 GB → 2 MB → THP → base pages; pages()
+ *   reports what was obtained. Arrays under 2 MB always use base pages
+ * * Growable in place: allocate(n, pages, cap) reserves address space
+ *   for cap elements but commits only the first n (the rest is
+ *   PROT_NONE and costs no memory); grow() opens further pages, so
+ *   data() never moves and raw indices stay valid
+ * * Move-only; trivially copyable element types only
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+/* page size of a host mapping, in fallback order ---------------------- */
+enum class HostPages : uint32_t { Base = 0, Transparent = 1, Huge2M = 2, Huge1G = 3 };
+
+inline const char* host_pages_name(HostPages p)
+{
+    switch(p){
+        case HostPages::Huge1G:      return "1 GB";
+        case HostPages::Huge2M:      return "2 MB";
+        case HostPages::Transparent: return "2 MB THP";
+        default:                     return "4 KB";
+    }
+}
+
+/* bytes per page as seen by mbind / alignment ------------------------- */
+inline uint64_t host_page_bytes(HostPages p)
+{
+    switch(p){
+        case HostPages::Huge1G:      return 1ull<<30;
+        case HostPages::Huge2M:
+        case HostPages::Transparent: return 1ull<<21;
+        default:                     return uint64_t(sysconf(_SC_PAGESIZE));
+    }
+}
+
+/* ===================================================================== */
+template<class T>
+class HostArray
+{
+    static_assert(std::is_trivially_copyable_v<T>, "raw pages only");
+public:
+    HostArray() = default;
+    explicit HostArray(uint64_t n, HostPages pages = HostPages::Base) { allocate(n, pages); }
+    ~HostArray() { release(); }
+
+    HostArray(const HostArray&)            = delete;
+    HostArray& operator=(const HostArray&) = delete;
+    HostArray(HostArray&& o) noexcept { swap(o); }
+    HostArray& operator=(HostArray&& o) noexcept
+    {
+        if(this != &o){ release(); swap(o); }
+        return *this;
+    }
+
+    /* n zeroed elements; previous contents are dropped. cap > n leaves
+       room to grow() up to cap elements without moving the array      */
+    void allocate(uint64_t n, HostPages want = HostPages::Base, uint64_t cap = 0)
+    {
+        release();
+        cap = std::max(cap, n);
+        if(!cap) return;
+        const uint64_t bytes = cap*sizeof(T);
+        if(bytes < (1ull<<21)) want = HostPages::Base;
+
+        const bool reserve = cap > n;
+        for(uint32_t p = uint32_t(want); ; --p){
+            if(map(bytes, HostPages(p), reserve)) break;
+            if(p == 0) throw new std::bad_alloc();
+        }
+        cap_ = cap;
+        if(!reserve){ n_ = n; open_ = len_; return; }
+        if(!grow(n)){ release(); throw new std::bad_alloc(); }
+    }
+
+    /* n ≤ capacity() elements in place; the new ones are zero. false →
+       beyond the reservation or the pages could not be opened         */
+    bool grow(uint64_t n)
+    {
+        if(n < n_ || n > cap_) return false;
+        const uint64_t need = std::min(round_up(n*sizeof(T), host_page_bytes(pages_)), len_);
+        if(need > open_){
+            char* base = reinterpret_cast<char*>(p_);
+            if(::mprotect(base + open_, need - open_, PROT_READ|PROT_WRITE) != 0) return false;
+            open_ = need;
+        }
+        n_ = n;
+        return true;
+    }
+
+    void release()
+    {
+        if(p_) ::munmap(p_, len_);
+        p_ = nullptr; n_ = 0; cap_ = 0; len_ = 0; open_ = 0; pages_ = HostPages::Base;
+    }
+
+    T*        data()        { return p_; }
+    const T*  data()  const { return p_; }
+    uint64_t  size()  const { return n_; }
+    uint64_t  capacity() const { return cap_; }
+    uint64_t  bytes() const { return n_*sizeof(T); }
+    bool      empty() const { return n_ == 0; }
+    HostPages pages() const { return pages_; }
+
+    T&       operator[](uint64_t i)       { return p_[i]; }
+    const T& operator[](uint64_t i) const { return p_[i]; }
+
+private:
+    static uint64_t round_up(uint64_t x, uint64_t a) { return (x + a - 1) & ~(a - 1); }
+
+    /* one attempt at page size p; false → try the next smaller one.
+       reserve → address space only, grow() opens it                  */
+    bool map(uint64_t bytes, HostPages p, bool reserve)
+    {
+        const int prot  = reserve ? PROT_NONE : PROT_READ|PROT_WRITE;
+#if defined(MAP_NORESERVE)
+        /* no swap reservation up front: an array that is replaced before
+           it is touched (mapped .bnn load) never counts against memory */
+        const int flags = MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE;
+#else
+        const int flags = MAP_PRIVATE|MAP_ANONYMOUS;
+#endif
+
+        if(p == HostPages::Huge1G || p == HostPages::Huge2M){
+#if defined(MAP_HUGETLB)
+            const int      shift = p == HostPages::Huge1G ? 30 : 21;
+            const uint64_t len   = round_up(bytes, 1ull<<shift);
+            void* m = ::mmap(nullptr, len, prot, flags|MAP_HUGETLB|(shift<<MAP_HUGE_SHIFT), -1, 0);
+            if(m == MAP_FAILED) return false;
+            adopt(m, len, p);
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        if(p == HostPages::Transparent){
+#if defined(MADV_HUGEPAGE)
+            /* over-map by 2 MB and trim so the array starts on a huge page */
+            const uint64_t hp  = 1ull<<21;
+            const uint64_t len = round_up(bytes, hp);
+            void* m = ::mmap(nullptr, len + hp, prot, flags, -1, 0);
+            if(m == MAP_FAILED) return false;
+            char* raw  = static_cast<char*>(m);
+            char* base = reinterpret_cast<char*>(round_up(reinterpret_cast<uint64_t>(raw), hp));
+            if(base > raw)      ::munmap(raw, base - raw);
+            if(base < raw + hp) ::munmap(base + len, raw + hp - base);
+            if(::madvise(base, len, MADV_HUGEPAGE) != 0){
+                adopt(base, len, HostPages::Base);
+                return true;
+            }
+            adopt(base, len, p);
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        void* m = ::mmap(nullptr, bytes, prot, flags, -1, 0);
+        if(m == MAP_FAILED) return false;
+        adopt(m, bytes, HostPages::Base);
+        return true;
+    }
+
+    void adopt(void* m, uint64_t len, HostPages p)
+    {
+        p_ = static_cast<T*>(m); len_ = len; pages_ = p;
+    }
+
+    void swap(HostArray& o) noexcept
+    {
+        std::swap(p_, o.p_);     std::swap(n_, o.n_);     std::swap(cap_, o.cap_);
+        std::swap(len_, o.len_); std::swap(open_, o.open_); std::swap(pages_, o.pages_);
+    }
+
+    T*        p_{nullptr};
+    uint64_t  n_{0};
+    uint64_t  cap_{0};          /* elements the mapping has room for  */
+    uint64_t  len_{0};          /* mapped bytes (rounded to the page) */
+    uint64_t  open_{0};         /* leading bytes readable / writable  */
+    HostPages pages_{HostPages::Base};
+};
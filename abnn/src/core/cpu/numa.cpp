@@ -0,0 +1,112 @@
+// numa.cpp  –  sysfs topology, sched_setaffinity, mbind
+// ======================================================================
+
+#include "numa.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* <numaif.h> lives in libnuma-dev; the syscall ABI is all we need */
+static constexpr int      kMpolBind       = 2;
+static constexpr int      kMpolInterleave = 3;
+static constexpr unsigned kMpolMfMove     = 1u<<1;
+#endif
+
+/* "0-3,8,10-11" → {0,1,2,3,8,10,11} */
+static std::vector<int> parse_cpulist(const std::string& s)
+{
+    std::vector<int> out;
+    std::stringstream ss(s);
+    std::string part;
+    while(std::getline(ss, part, ',')){
+        int a=0, b=0;
+        if(std::sscanf(part.c_str(), "%d-%d", &a, &b)==2) for(int c=a;c<=b;++c) out.push_back(c);
+        else if(std::sscanf(part.c_str(), "%d", &a)==1)  out.push_back(a);
+    }
+    return out;
+}
+
+/* ===================================================================== */
+const NumaTopology& numa_topology()
+{
+    static const NumaTopology topo = []{
+        NumaTopology t;
+#if defined(__linux__)
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string line;
+        std::getline(online, line);
+        for(int n : parse_cpulist(line)){
+            std::ifstream f("/sys/devices/system/node/node"+std::to_string(n)+"/cpulist");
+            std::string list;
+            std::getline(f, list);
+            auto cpus = parse_cpulist(list);
+            if(cpus.empty()) continue;               /* memory-only node */
+            t.id.push_back(uint32_t(n));
+            t.cpus.push_back(std::move(cpus));
+        }
+#endif
+        if(t.cpus.empty()){ t.id = { 0 }; t.cpus = { {} }; }   /* one node, any cpu */
+        return t;
+    }();
+    return topo;
+}
+
+/* ===================================================================== */
+#if defined(__linux__)
+bool numa_pin_thread(uint32_t node)
+{
+    const auto& t = numa_topology();
+    if(node >= t.n_nodes() || t.cpus[node].empty()) return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(int c : t.cpus[node]) CPU_SET(c, &set);
+    return sched_setaffinity(0, sizeof(set), &set)==0;
+}
+
+/* nodemask of kernel ids, as many words as the largest id needs */
+static std::vector<unsigned long> node_mask(const std::vector<uint32_t>& ids)
+{
+    std::vector<unsigned long> mask(*std::max_element(ids.begin(), ids.end())/64 + 1, 0ul);
+    for(uint32_t n : ids) mask[n/64] |= 1ul << (n%64);
+    return mask;
+}
+
+static bool mbind_pages(void* p, uint64_t bytes, uint64_t pg, int mode,
+                        const std::vector<unsigned long>& mask)
+{
+    if(!pg) pg = uint64_t(sysconf(_SC_PAGESIZE));
+    uint64_t b = (reinterpret_cast<uint64_t>(p) + pg - 1) & ~(pg - 1);
+    uint64_t e = (reinterpret_cast<uint64_t>(p) + bytes)  & ~(pg - 1);
+    if(e <= b) return false;
+    /* the kernel reads maxnode - 1 bits */
+    return ::syscall(SYS_mbind, b, e - b, mode, mask.data(), mask.size()*64 + 1, kMpolMfMove)==0;
+}
+
+bool numa_bind(void* p, uint64_t bytes, uint32_t node, uint64_t page)
+{
+    const auto& t = numa_topology();
+    if(t.n_nodes() < 2 || node >= t.n_nodes()) return false;
+    return mbind_pages(p, bytes, page, kMpolBind, node_mask({ t.id[node] }));
+}
+
+bool numa_interleave(void* p, uint64_t bytes, uint64_t page)
+{
+    const auto& t = numa_topology();
+    if(t.n_nodes() < 2) return false;
+    return mbind_pages(p, bytes, page, kMpolInterleave, node_mask(t.id));
+}
+
+#else
+bool numa_pin_thread(uint32_t)                      { return false; }
+bool numa_bind(void*, uint64_t, uint32_t, uint64_t) { return false; }
+bool numa_interleave(void*, uint64_t, uint64_t)     { return false; }
+#endif
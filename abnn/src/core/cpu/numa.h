@@ -0,0 +1,32 @@
+#pragma once
+/* numa.h  –  node topology, thread pinning and page placement
+ * =====================================================================
+ * * Topology comes from /sys/devices/system/node (Linux): the online
+ *   nodes that have cpus, each with its kernel id (ids may be sparse;
+ *   memory-only nodes such as CXL / HBM get no workers and no shards).
+ *   Elsewhere, or when the directory is missing, the machine is one
+ *   node
+ * * Node arguments are indices into the topology, mapped to kernel ids
+ *   for the mbind masks
+ * * numa_bind / numa_interleave set an mbind policy on whole pages in
+ *   [p, p+bytes) and migrate pages already faulted in; ranges are
+ *   shrunk to page boundaries, so neighbouring shards never fight over
+ *   a page
+ * * Every call is best effort: false means "left where it was"
+ */
+
+#include <cstdint>
+#include <vector>
+
+struct NumaTopology
+{
+    std::vector<uint32_t>         id;        /* per node, kernel node id */
+    std::vector<std::vector<int>> cpus;      /* per node, online cpus    */
+    uint32_t n_nodes() const { return uint32_t(cpus.size()); }
+};
+
+const NumaTopology& numa_topology();         /* read once, cached */
+
+bool numa_pin_thread(uint32_t node);         /* calling thread → node's cpus */
+bool numa_bind      (void* p, uint64_t bytes, uint32_t node, uint64_t page = 0);
+bool numa_interleave(void* p, uint64_t bytes, uint64_t page = 0);
@@ -0,0 +1,49 @@
+// perf-counter.cpp  –  perf_event_open miss counters
+// ======================================================================
+
+#include "perf-counter.h"
+
+#if defined(__linux__)
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+PerfCounter::~PerfCounter()
+{
+    if(fd_ >= 0) ::close(fd_);
+}
+
+bool PerfCounter::open(PerfEvent ev)
+{
+    perf_event_attr a;
+    std::memset(&a, 0, sizeof(a));
+    a.size           = sizeof(a);
+    if(ev==PerfEvent::DtlbMisses){
+        a.type       = PERF_TYPE_HW_CACHE;
+        a.config     = PERF_COUNT_HW_CACHE_DTLB
+                     | (PERF_COUNT_HW_CACHE_OP_READ     << 8)
+                     | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    } else {
+        a.type       = PERF_TYPE_HARDWARE;
+        a.config     = PERF_COUNT_HW_CACHE_MISSES;
+    }
+    a.exclude_kernel = 1;
+    a.exclude_hv     = 1;
+
+    fd_ = int(::syscall(SYS_perf_event_open, &a, 0 /*this thread*/, -1, -1, 0));
+    return fd_ >= 0;
+}
+
+uint64_t PerfCounter::read() const
+{
+    uint64_t v = 0;
+    if(fd_ < 0 || ::read(fd_, &v, sizeof(v)) != ssize_t(sizeof(v))) return 0;
+    return v;
+}
+
+#else
+PerfCounter::~PerfCounter() {}
+bool     PerfCounter::open(PerfEvent) { return false; }
+uint64_t PerfCounter::read() const    { return 0; }
+#endif
@@ -0,0 +1,31 @@
+#pragma once
+/* perf-counter.h  –  per-thread hardware miss counter
+ * =====================================================================
+ * * Linux perf_event_open, user space only, counting the thread that
+ *   called open(): last-level cache misses or dTLB load misses
+ * * Unavailable (other OS, no PMU, perf_event_paranoid too high) →
+ *   valid() is false and read() returns 0
+ */
+
+#include <cstdint>
+
+enum class PerfEvent : uint32_t { CacheMisses = 0, DtlbMisses = 1 };
+
+class PerfCounter
+{
+public:
+    PerfCounter() = default;
+    ~PerfCounter();
+
+    PerfCounter(const PerfCounter&)            = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+
+    /* attach to the calling thread; false → counter unavailable */
+    bool open(PerfEvent ev = PerfEvent::CacheMisses);
+
+    bool     valid() const { return fd_ >= 0; }
+    uint64_t read () const;          /* events since open()            */
+
+private:
+    int fd_{-1};
+};
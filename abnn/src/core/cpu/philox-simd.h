@@ -0,0 +1,91 @@
+#pragma once
+/* philox-simd.h  –  8- and 16-lane Philox4x32-10 (x86 only)
+ * =====================================================================
+ * * One counter per lane, same arithmetic as philox() in philox.h
+ * * mulhi comes from two _mul_epu32 (even / odd lanes) blended together
+ * * Included by the SIMD translation units only
+ */
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#include "philox.h"
+
+#ifndef ABNN_AVX2
+#define ABNN_AVX2   __attribute__((target("avx2,f16c")))
+#define ABNN_AVX512 __attribute__((target("avx512f")))
+#endif
+
+/* ===================================================================== */
+/* counters base+lane; word 0 carries into word 1 (index bits 32..47)    */
+ABNN_AVX2 static inline void philox_counters_avx2(Philox4 base, __m256i lane,
+                                                  __m256i& c0, __m256i& c1,
+                                                  __m256i& c2, __m256i& c3)
+{
+    const __m256i b    = _mm256_set1_epi32((int)base.v[0]);
+    const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+    c0 = _mm256_add_epi32(b, lane);
+    c1 = _mm256_sub_epi32(_mm256_set1_epi32((int)base.v[1]),         /* +1 if c0 < b */
+             _mm256_cmpgt_epi32(_mm256_xor_si256(b,sign), _mm256_xor_si256(c0,sign)));
+    c2 = _mm256_set1_epi32((int)base.v[2]);
+    c3 = _mm256_set1_epi32((int)base.v[3]);
+}
+
+ABNN_AVX2 static inline __m256i mulhi_epu32(__m256i a, __m256i m)
+{
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(a, m), 32);
+    __m256i odd  = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    return _mm256_blend_epi32(even, odd, 0xAA);
+}
+
+ABNN_AVX2 static inline void philox_avx2(PhiloxKey k, __m256i& c0, __m256i& c1,
+                                         __m256i& c2, __m256i& c3)
+{
+    const __m256i m0 = _mm256_set1_epi32((int)kPhiloxM0);
+    const __m256i m1 = _mm256_set1_epi32((int)kPhiloxM1);
+    for(int r=0; r<10; ++r){
+        __m256i hi0 = mulhi_epu32(c0, m0), lo0 = _mm256_mullo_epi32(c0, m0);
+        __m256i hi1 = mulhi_epu32(c2, m1), lo1 = _mm256_mullo_epi32(c2, m1);
+        c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32((int)k.k0));
+        c1 = lo1;
+        c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32((int)k.k1));
+        c3 = lo0;
+        k.k0 += kPhiloxW0;  k.k1 += kPhiloxW1;
+    }
+}
+
+/* ===================================================================== */
+ABNN_AVX512 static inline void philox_counters_avx512(Philox4 base, __m512i lane,
+                                                      __m512i& c0, __m512i& c1,
+                                                      __m512i& c2, __m512i& c3)
+{
+    const __m512i b  = _mm512_set1_epi32((int)base.v[0]);
+    const __m512i w1 = _mm512_set1_epi32((int)base.v[1]);
+    c0 = _mm512_add_epi32(b, lane);
+    c1 = _mm512_mask_add_epi32(w1, _mm512_cmplt_epu32_mask(c0, b), w1, _mm512_set1_epi32(1));
+    c2 = _mm512_set1_epi32((int)base.v[2]);
+    c3 = _mm512_set1_epi32((int)base.v[3]);
+}
+
+ABNN_AVX512 static inline __m512i mulhi_epu32(__m512i a, __m512i m)
+{
+    __m512i even = _mm512_srli_epi64(_mm512_mul_epu32(a, m), 32);
+    __m512i odd  = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), m);
+    return _mm512_mask_blend_epi32(0xAAAA, even, odd);
+}
+
+ABNN_AVX512 static inline void philox_avx512(PhiloxKey k, __m512i& c0, __m512i& c1,
+                                             __m512i& c2, __m512i& c3)
+{
+    const __m512i m0 = _mm512_set1_epi32((int)kPhiloxM0);
+    const __m512i m1 = _mm512_set1_epi32((int)kPhiloxM1);
+    for(int r=0; r<10; ++r){
+        __m512i hi0 = mulhi_epu32(c0, m0), lo0 = _mm512_mullo_epi32(c0, m0);
+        __m512i hi1 = mulhi_epu32(c2, m1), lo1 = _mm512_mullo_epi32(c2, m1);
+        c0 = _mm512_ternarylogic_epi32(hi1, c1, _mm512_set1_epi32((int)k.k0), 0x96);
+        c1 = lo1;
+        c2 = _mm512_ternarylogic_epi32(hi0, c3, _mm512_set1_epi32((int)k.k1), 0x96);
+        c3 = lo0;
+        k.k0 += kPhiloxW0;  k.k1 += kPhiloxW1;
+    }
+}
+#endif /* __x86_64__ */
@@ -0,0 +1,105 @@
+// philox.cpp  –  batch Philox4x32-10 generation
+// ======================================================================
+// Counters are consecutive, so a block of 8 / 16 lanes is one vector
+// add away; the four output words per counter are transposed back into
+// counter-major order before the store.
+
+#include "philox.h"
+#include "philox-simd.h"
+#include "traversal-kernels.h"
+
+#include <algorithm>
+
+/* ===================================================================== */
+static void fill_scalar(PhiloxKey k, uint32_t stream, uint64_t pass,
+                        uint64_t first, uint64_t nCtr, uint32_t* out)
+{
+    for(uint64_t j=0; j<nCtr; ++j){
+        Philox4 r = philox(k, philox_counter(first+j, pass, stream));
+        for(int m=0; m<4; ++m) out[4*j+m] = r.v[m];
+    }
+}
+
+#if defined(__x86_64__)
+ABNN_AVX2 static uint64_t fill_avx2(PhiloxKey k, uint32_t stream, uint64_t pass,
+                                    uint64_t first, uint64_t nCtr, uint32_t* out)
+{
+    const __m256i lane = _mm256_setr_epi32(0,1,2,3,4,5,6,7);
+    uint64_t j=0;
+    for(; j+8<=nCtr; j+=8){
+        __m256i c0, c1, c2, c3;
+        philox_counters_avx2(philox_counter(first+j, pass, stream), lane, c0, c1, c2, c3);
+        philox_avx2(k, c0, c1, c2, c3);
+
+        /* 4×8 words → 8 counter-major quads */
+        __m256i t0=_mm256_unpacklo_epi32(c0,c1), t1=_mm256_unpackhi_epi32(c0,c1),
+                t2=_mm256_unpacklo_epi32(c2,c3), t3=_mm256_unpackhi_epi32(c2,c3);
+        __m256i u0=_mm256_unpacklo_epi64(t0,t2), u1=_mm256_unpackhi_epi64(t0,t2),
+                u2=_mm256_unpacklo_epi64(t1,t3), u3=_mm256_unpackhi_epi64(t1,t3);
+        __m256i* o = reinterpret_cast<__m256i*>(out+4*j);
+        _mm256_storeu_si256(o,   _mm256_permute2x128_si256(u0,u1,0x20));
+        _mm256_storeu_si256(o+1, _mm256_permute2x128_si256(u2,u3,0x20));
+        _mm256_storeu_si256(o+2, _mm256_permute2x128_si256(u0,u1,0x31));
+        _mm256_storeu_si256(o+3, _mm256_permute2x128_si256(u2,u3,0x31));
+    }
+    return j;
+}
+
+ABNN_AVX512 static uint64_t fill_avx512(PhiloxKey k, uint32_t stream, uint64_t pass,
+                                        uint64_t first, uint64_t nCtr, uint32_t* out)
+{
+    const __m512i lane = _mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    uint64_t j=0;
+    for(; j+16<=nCtr; j+=16){
+        __m512i c0, c1, c2, c3;
+        philox_counters_avx512(philox_counter(first+j, pass, stream), lane, c0, c1, c2, c3);
+        philox_avx512(k, c0, c1, c2, c3);
+
+        /* 4×16 words → 16 counter-major quads */
+        __m512i t0=_mm512_unpacklo_epi32(c0,c1), t1=_mm512_unpackhi_epi32(c0,c1),
+                t2=_mm512_unpacklo_epi32(c2,c3), t3=_mm512_unpackhi_epi32(c2,c3);
+        __m512i u0=_mm512_unpacklo_epi64(t0,t2), u1=_mm512_unpackhi_epi64(t0,t2),
+                u2=_mm512_unpacklo_epi64(t1,t3), u3=_mm512_unpackhi_epi64(t1,t3);
+        __m512i v0=_mm512_shuffle_i32x4(u0,u1,0x44), v1=_mm512_shuffle_i32x4(u2,u3,0x44),
+                v2=_mm512_shuffle_i32x4(u0,u1,0xEE), v3=_mm512_shuffle_i32x4(u2,u3,0xEE);
+        uint32_t* o = out+4*j;
+        _mm512_storeu_si512(o,    _mm512_shuffle_i32x4(v0,v1,0x88));
+        _mm512_storeu_si512(o+16, _mm512_shuffle_i32x4(v0,v1,0xDD));
+        _mm512_storeu_si512(o+32, _mm512_shuffle_i32x4(v2,v3,0x88));
+        _mm512_storeu_si512(o+48, _mm512_shuffle_i32x4(v2,v3,0xDD));
+    }
+    return j;
+}
+#endif
+
+/* ===================================================================== */
+void philox_fill(PhiloxKey k, uint32_t stream, uint64_t pass,
+                 uint64_t first, uint64_t n, uint32_t* out)
+{
+    static const SimdLevel level = detect_simd_level();
+
+    const uint64_t nCtr = n/4;
+    uint64_t j = 0;
+#if defined(__x86_64__)
+    if(level==SimdLevel::Avx512)    j = fill_avx512(k, stream, pass, first, nCtr, out);
+    else if(level==SimdLevel::Avx2) j = fill_avx2  (k, stream, pass, first, nCtr, out);
+#endif
+    fill_scalar(k, stream, pass, first+j, nCtr-j, out+4*j);
+
+    if(n%4){                                    /* partial last counter */
+        Philox4 r = philox(k, philox_counter(first+nCtr, pass, stream));
+        for(uint64_t m=0; m<n%4; ++m) out[4*nCtr+m] = r.v[m];
+    }
+}
+
+void philox_uniform(PhiloxKey k, uint32_t stream, uint64_t pass,
+                    uint64_t first, uint64_t n, float* out)
+{
+    constexpr uint64_t kChunk = 1024;            /* words, multiple of 64 */
+    alignas(64) uint32_t bits[kChunk];
+    for(uint64_t i=0; i<n; i+=kChunk){
+        const uint64_t m = std::min(kChunk, n-i);
+        philox_fill(k, stream, pass, first + i/4, m, bits);
+        for(uint64_t j=0; j<m; ++j) out[i+j] = philox_u01(bits[j]);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+/* philox.h  –  counter-based Philox4x32-10 random numbers
+ * =====================================================================
+ * * Stateless: a draw is philox(key, counter), so any thread can
+ *   produce any number in any order and get the same value, regardless
+ *   of how a pass is decomposed
+ * * key = 64-bit seed; counter = (index, stream, pass):
+ *     word 0/1 : index (48 bit) | stream << 48
+ *     word 2/3 : pass number (64 bit)
+ * * Streams keep the consumers decorrelated: synapse draws, Poisson
+ *   input spikes and teacher forcing never share a counter
+ * * brain.metal implements the same function; philox_fill() is the
+ *   vectorised batch generator (AVX-512 / AVX2 / scalar)
+ */
+
+#include <cstdint>
+
+struct PhiloxKey { uint32_t k0, k1; };
+struct Philox4   { uint32_t v[4]; };
+
+enum PhiloxStream : uint32_t
+{
+    kStreamSynapse = 0,       /* per-synapse fire draw + weight rounding */
+    kStreamInput   = 1,       /* Poisson input spikes                    */
+    kStreamTeacher = 2,       /* teacher-forcing spikes                  */
+    kStreamGraph   = 3,       /* graph construction (graph-builder.h)    */
+    kStreamRewire  = 4,       /* synaptogenesis (Brain::rewire)          */
+    kStreamGrow    = 5,       /* wiring of new neurons (grow_neurons)    */
+};
+
+static constexpr uint32_t kPhiloxM0 = 0xD2511F53u, kPhiloxM1 = 0xCD9E8D57u;
+static constexpr uint32_t kPhiloxW0 = 0x9E3779B9u, kPhiloxW1 = 0xBB67AE85u;
+
+inline PhiloxKey philox_key(uint64_t seed) { return { uint32_t(seed), uint32_t(seed>>32) }; }
+
+inline Philox4 philox_counter(uint64_t index, uint64_t pass, uint32_t stream)
+{
+    return {{ uint32_t(index),
+              uint32_t((index>>32) & 0xFFFFu) | (stream<<16),
+              uint32_t(pass), uint32_t(pass>>32) }};
+}
+
+/* ===================================================================== */
+inline Philox4 philox(PhiloxKey k, Philox4 c)
+{
+    for(int r=0; r<10; ++r){
+        const uint64_t p0 = uint64_t(kPhiloxM0) * c.v[0];
+        const uint64_t p1 = uint64_t(kPhiloxM1) * c.v[2];
+        c = {{ uint32_t(p1>>32) ^ c.v[1] ^ k.k0, uint32_t(p1),
+               uint32_t(p0>>32) ^ c.v[3] ^ k.k1, uint32_t(p0) }};
+        k.k0 += kPhiloxW0;  k.k1 += kPhiloxW1;
+    }
+    return c;
+}
+
+/* top 24 bits → [0,1) */
+inline float philox_u01(uint32_t x) { return float(x>>8) * (1.0f/16777216.0f); }
+
+/* ===================================================================== */
+/* batch generation: counters first .. first+⌈n/4⌉-1, 4 words each,
+   out[4j+m] = word m of counter first+j                                */
+void philox_fill   (PhiloxKey, uint32_t stream, uint64_t pass,
+                    uint64_t first, uint64_t n, uint32_t* out);
+void philox_uniform(PhiloxKey, uint32_t stream, uint64_t pass,
+                    uint64_t first, uint64_t n, float* out);
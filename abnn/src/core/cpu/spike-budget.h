@@ -0,0 +1,126 @@
+#pragma once
+/* spike-budget.h  –  per-pass spike cap without a shared hot counter
+ * =====================================================================
+ * * kMaxSpikes tokens per pass start in a global pool; a worker moves
+ *   them to its own cache line in blocks and spends them locally, so
+ *   the shared line is touched once per block instead of per spike
+ * * A worker whose block and the pool are both empty steals half of
+ *   another worker's block before it gives up
+ * * Tokens only move, so at most `total` spikes are granted per pass;
+ *   exhausted() is true once no worker holds a token, as the old
+ *   single counter was at 0
+ * * A move takes tokens with one CAS and hands them over with a second
+ *   add, so they are briefly in neither place. Moves in flight are
+ *   counted and finished ones numbered: a worker only declares the
+ *   budget spent after a scan that found nothing while no move was in
+ *   flight or finished, so exactly `total` spikes can be granted
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/* runs between a move's CAS and its add; spike-budget-check.cpp widens
+   the window with it to exercise the in-flight accounting            */
+#ifndef SPIKE_BUDGET_MOVE_WINDOW
+#define SPIKE_BUDGET_MOVE_WINDOW()
+#endif
+
+class SpikeBudget
+{
+public:
+    /* new pass: all tokens back in the pool, every block empty */
+    void reset(uint32_t total, uint32_t nWorkers)
+    {
+        if(local_.size()!=nWorkers) local_ = std::vector<Slot>(nWorkers);
+        for(auto& s : local_) s.left.store(0, std::memory_order_relaxed);
+        pool_.store(total, std::memory_order_relaxed);
+        moving_.store(0, std::memory_order_relaxed);
+        moved_.store(0, std::memory_order_relaxed);
+        done_.store(total==0, std::memory_order_relaxed);
+        refills_.store(0, std::memory_order_relaxed);
+        block_ = std::clamp<uint32_t>(total / (4*std::max(nWorkers,1u)), 1u, kMaxBlock);
+    }
+
+    /* one spike for worker w; false → budget spent */
+    bool take(uint32_t w)
+    {
+        std::atomic<uint32_t>& l = local_[w].left;
+        for(;;){
+            uint32_t b = l.load(std::memory_order_relaxed);
+            while(b && !l.compare_exchange_weak(b, b-1, std::memory_order_relaxed)) {}
+            if(b) return true;
+            if(!acquire(w)) return false;
+        }
+    }
+
+    /* no token left anywhere for worker w: the gating test that stops
+       counting synapses, equivalent to a global budget of 0          */
+    bool exhausted(uint32_t w)
+    {
+        return local_[w].left.load(std::memory_order_relaxed)==0u && !acquire(w);
+    }
+
+    /* shared-line operations this pass (block grabs + steals) */
+    uint64_t refills() const { return refills_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t kMaxBlock = 64;
+
+    /* one cache line per worker so the counters never share a line */
+    struct alignas(64) Slot { std::atomic<uint32_t> left{0}; };
+
+    /* a block of the tokens in `from` (half of them for a steal) into
+       worker w's block, counted in flight until they have arrived    */
+    bool move(std::atomic<uint32_t>& from, uint32_t w, bool half)
+    {
+        uint32_t x = from.load();
+        while(x){
+            const uint32_t n = half ? (x+1)/2 : std::min(x, block_);
+            moving_.fetch_add(1);
+            const bool ok = from.compare_exchange_weak(x, x-n);
+            if(ok){
+                SPIKE_BUDGET_MOVE_WINDOW();
+                local_[w].left.fetch_add(n);
+                moved_.fetch_add(1);
+            }
+            moving_.fetch_sub(1);
+            if(ok) return true;
+        }
+        return false;
+    }
+
+    /* block from the pool, else half of another worker's block */
+    bool acquire(uint32_t w)
+    {
+        if(done_.load(std::memory_order_relaxed)) return false;
+        refills_.fetch_add(1, std::memory_order_relaxed);
+
+        const uint32_t nW = uint32_t(local_.size());
+        for(;;){
+            const uint64_t m0    = moved_.load();
+            const bool     idle0 = moving_.load()==0;
+
+            if(move(pool_, w, false)) return true;
+            for(uint32_t k=1; k<nW; ++k)
+                if(move(local_[(w+k)%nW].left, w, true)) return true;
+
+            /* nothing seen, and nothing moved under the scan */
+            if(idle0 && moving_.load()==0 && moved_.load()==m0) break;
+            if(done_.load(std::memory_order_relaxed)) return false;
+        }
+        done_.store(true, std::memory_order_relaxed);
+        return false;
+    }
+
+    /* pool and refill count change together; done_ is read on every
+       gated synapse, so it sits on a line that is written once      */
+    alignas(64) std::atomic<uint32_t> pool_{0};
+    std::atomic<uint64_t>             refills_{0};
+    std::atomic<uint32_t>             moving_{0};     /* moves in flight */
+    std::atomic<uint64_t>             moved_{0};      /* moves finished  */
+    alignas(64) std::atomic<bool>     done_{false};
+    uint32_t                          block_{1};
+    std::vector<Slot>                 local_;
+};
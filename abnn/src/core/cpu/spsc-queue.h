@@ -0,0 +1,62 @@
+#pragma once
+/* spsc-queue.h  –  bounded single-producer / single-consumer ring
+ * =====================================================================
+ * * Lock-free: the producer owns tail_, the consumer owns head_, each
+ *   on its own cache line; acquire/release on the indices publishes
+ *   the slot contents
+ * * Capacity is rounded up to a power of two
+ * * try_push / try_pop never block; callers decide how to wait
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+template<class T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(uint32_t capacity)
+    {
+        uint32_t n = 1;
+        while(n < capacity) n <<= 1;
+        slots_.resize(n);
+        mask_ = n - 1;
+    }
+
+    SpscQueue(const SpscQueue&)            = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /* producer: false → full, v untouched */
+    bool try_push(T&& v)
+    {
+        const uint64_t t = tail_.load(std::memory_order_relaxed);
+        if(t - head_.load(std::memory_order_acquire) > mask_) return false;
+        slots_[t & mask_] = std::move(v);
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* consumer: false → empty */
+    bool try_pop(T& out)
+    {
+        const uint64_t h = head_.load(std::memory_order_relaxed);
+        if(h == tail_.load(std::memory_order_acquire)) return false;
+        out = std::move(slots_[h & mask_]);
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* approximate from either side */
+    uint64_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T>                    slots_;
+    uint64_t                          mask_{0};
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+};
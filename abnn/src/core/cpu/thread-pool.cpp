@@ -0,0 +1,78 @@
+// thread-pool.cpp  –  persistent worker pool for the CPU backend
+// ======================================================================
+
+#include "thread-pool.h"
+
+#include <algorithm>
+
+/* ===================================================================== */
+/* ctor / dtor                                                           */
+ThreadPool::ThreadPool(uint32_t n)
+: nThreads_(n ? n : std::max(1u, std::thread::hardware_concurrency()))
+{
+    threads_.reserve(nThreads_-1);
+    for(uint32_t w=1; w<nThreads_; ++w)
+        threads_.emplace_back(&ThreadPool::worker_main, this, w);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        quit_ = true;
+    }
+    wake_.notify_all();
+    for(auto& t : threads_) if(t.joinable()) t.join();
+}
+
+/* ===================================================================== */
+/* parked workers wait for the next generation                           */
+void ThreadPool::worker_main(uint32_t w)
+{
+    uint64_t seen = 0;
+    for(;;){
+        const Job* job;
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            wake_.wait(lk, [&]{ return quit_ || generation_!=seen; });
+            if(quit_) return;
+            seen = generation_;
+            job  = job_;
+        }
+
+        (*job)(w);
+
+        std::lock_guard<std::mutex> lk(mtx_);
+        if(--pending_==0) done_.notify_one();
+    }
+}
+
+/* ===================================================================== */
+void ThreadPool::run(const Job& fn)
+{
+    if(nThreads_==1){ fn(0); return; }
+
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        job_     = &fn;
+        pending_ = nThreads_-1;
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    fn(0);                                   /* caller is worker 0 */
+
+    std::unique_lock<std::mutex> lk(mtx_);
+    done_.wait(lk, [&]{ return pending_==0; });
+    job_ = nullptr;
+}
+
+/* ===================================================================== */
+void ThreadPool::parallel_for(uint64_t n, const RangeJob& fn)
+{
+    const uint64_t T = nThreads_;
+    run([&](uint32_t w){
+        uint64_t b = n*w/T, e = n*(w+1)/T;
+        if(b<e) fn(b,e,w);
+    });
+}
@@ -0,0 +1,51 @@
+#pragma once
+/* thread-pool.h  –  persistent worker pool for the CPU backend
+ * =====================================================================
+ * * Workers are created once and parked on a condition variable
+ * * run() wakes every worker with the same job and blocks until all
+ *   of them have returned; the calling thread acts as worker 0
+ * * parallel_for() shards [0,n) into one contiguous range per worker
+ */
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    using Job      = std::function<void(uint32_t worker)>;
+    using RangeJob = std::function<void(uint64_t begin, uint64_t end, uint32_t worker)>;
+
+    /* nThreads == 0 → std::thread::hardware_concurrency() */
+    explicit ThreadPool(uint32_t nThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    uint32_t size() const { return nThreads_; }
+
+    /* fn(worker) on every worker, blocking */
+    void run(const Job& fn);
+
+    /* static contiguous shard of [0,n), blocking */
+    void parallel_for(uint64_t n, const RangeJob& fn);
+
+private:
+    void worker_main(uint32_t worker);
+
+    uint32_t                 nThreads_;
+    std::vector<std::thread> threads_;
+
+    std::mutex               mtx_;
+    std::condition_variable  wake_;
+    std::condition_variable  done_;
+    const Job*               job_{nullptr};
+    uint64_t                 generation_{0};
+    uint32_t                 pending_{0};
+    bool                     quit_{false};
+};
@@ -0,0 +1,175 @@
+#pragma once
+/* traversal-kernels.h  –  per-range bodies of the CPU pass
+ * =====================================================================
+ * * A RangeKernel visits synapses [begin,end) of one shard with the
+ *   exact monte_carlo_traversal semantics and returns its counters
+ * * Scalar kernel is the reference; AVX2 (8 lanes) and AVX-512
+ *   (16 lanes) variants gather lastFired, gate with masked compares,
+ *   draw Philox numbers in-register and write weights back masked
+ * * Each gated synapse draws philox(key, (index, kStreamSynapse, pass)):
+ *   word 0 decides the spike, word 1 rounds narrow weights
+ * * Every level exists for both synapse layouts; the SoA kernels stream
+ *   src[] alone and load dst[]/w[] only for blocks with a live pre-spike
+ * * SoA kernels dispatch once per range on the weight format: narrow
+ *   weights are widened to f32 for the update and written back with
+ *   stochastic rounding
+ * * select_kernel() picks the widest level the CPU supports at runtime
+ * * With a recent-spike bitmap the WINDOW_PRE gate tests one bit per
+ *   source instead of gathering lastFired; a committed spike sets the
+ *   bit of its neuron so later synapses in the pass see it as before
+ * * Free slots (src kFreeSyn, structural plasticity) fail the
+ *   WINDOW_PRE gate before anything is gathered: one compare per
+ *   synapse and masked gathers
+ * * Every weight write-back marks its kDirtyBlock in the store's dirty
+ *   map (incremental checkpoints); a vector with any write marks the
+ *   blocks of its first and last synapse
+ * * While a snapshot is taken (SynapseStore::freeze) the same blocks
+ *   get keep_frozen() before the write, so the old weights are saved
+ *   once per block; one null test per write-back otherwise
+ * * Scan mode (PassContext::cand set, deterministic passes): kernels only
+ *   collect the gated synapses with their draws and write nothing;
+ *   commit_candidates() applies budget, plasticity and spikes afterwards
+ * * Every kernel is a template on SynapseKind, so a range of one source
+ *   type runs without a per-synapse type test:
+ *     Plain – homogeneous network, the kernel as it always was
+ *     Exc   – Plain plus one more gate: a target inhibited within
+ *             kInhibit ticks (bit of PassContext::quiet) does not fire
+ *     Inh   – same gates and draw at kInhGain × the odds, but a hit
+ *             spends no spike token: it stamps lastInhibit[dst] and
+ *             sets the dst's quiet bit, and the weight follows the same
+ *             STDP rule with the hit as the "fire" outcome
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "brain-types.h"
+#include "synapse-store.h"
+#include "philox.h"
+#include "spike-budget.h"
+
+/* a gated synapse recorded by a scan-mode kernel ----------------------- */
+struct Candidate
+{
+    uint64_t i;                          /* synapse index                */
+    uint32_t dst;
+    uint32_t ld;                         /* lastFired[dst] at pass start */
+    uint32_t rnd;                        /* Philox word 1 (rounding)     */
+    bool     want;                       /* draw says fire               */
+    bool     inh;                        /* inhibitory: want → a hit     */
+};
+
+/* everything a shard needs, fixed for the duration of one pass ---------- */
+struct PassContext
+{
+    SynapseView            syn;
+    uint32_t*              lastF;
+    uint32_t*              recent;       /* 1 bit / neuron fired within
+                                            WINDOW_PRE, nullptr → lastF */
+    uint32_t*              lastI;        /* last inhibitory hit, E/I only */
+    uint32_t*              quiet;        /* 1 bit / neuron hit within
+                                            kInhibit, E/I only           */
+    uint32_t               now;
+    uint64_t               pass;         /* Philox counter word 2/3 */
+    PhiloxKey              key;
+    float                  R, rBar;
+    PlasticityParams       pp;
+    SpikeBudget*           budget;
+    uint32_t               worker;       /* budget slot of this shard    */
+    std::vector<Candidate>* cand;        /* non-null → scan mode         */
+};
+
+/* scan mode: gated = candidates recorded, fired / inhibited = of which
+   want, by kind (only fired ones ask for spike tokens)                */
+struct RangeCounts { uint64_t gated, fired, inhibited; };
+
+using RangeKernel = RangeCounts (*)(const PassContext&, uint64_t begin, uint64_t end);
+
+/* what the synapses of a range do, by their sources' type ------------- */
+enum class SynapseKind : int { Plain = 0, Exc = 1, Inh = 2 };
+static constexpr int kSynapseKinds = 3;
+
+inline SynapseKind synapse_kind(NeuronType t)
+{
+    return t==NeuronType::Inh ? SynapseKind::Inh : SynapseKind::Exc;
+}
+
+/* hit odds per w²: inhibitory synapses are kInhGain stronger */
+template<SynapseKind K>
+constexpr float kind_scale() { return K==SynapseKind::Inh ? kBaseScale*kInhGain : kBaseScale; }
+
+/* SIMD dispatch --------------------------------------------------------- */
+enum class SimdLevel : int { Scalar = 0, Avx2 = 1, Avx512 = 2 };
+
+SimdLevel   detect_simd_level();                 /* best the CPU supports */
+const char* simd_level_name(SimdLevel);
+RangeKernel select_kernel(SimdLevel, SynapseLayout, SynapseKind = SynapseKind::Plain);
+
+template<SynapseKind K> RangeCounts traverse_scalar    (const PassContext&, uint64_t begin, uint64_t end);
+template<SynapseKind K> RangeCounts traverse_scalar_soa(const PassContext&, uint64_t begin, uint64_t end);
+#if defined(__x86_64__)
+template<SynapseKind K> RangeCounts traverse_avx2      (const PassContext&, uint64_t begin, uint64_t end);
+template<SynapseKind K> RangeCounts traverse_avx2_soa  (const PassContext&, uint64_t begin, uint64_t end);
+template<SynapseKind K> RangeCounts traverse_avx512    (const PassContext&, uint64_t begin, uint64_t end);
+template<SynapseKind K> RangeCounts traverse_avx512_soa(const PassContext&, uint64_t begin, uint64_t end);
+#endif
+
+/* deterministic commit: walks candidates in order, excitatory ones
+   while budget lasts, updates their weights and stores lastFired[dst]
+   = now for spikes (lastInhibit[dst] for inhibitory hits, which take
+   no budget and are all applied)                                     */
+RangeCounts commit_candidates(const PassContext&, const Candidate*, uint64_t n,
+                              uint32_t budget);
+
+/* shared helpers -------------------------------------------------------- */
+
+/* WINDOW_PRE gate for one source */
+inline bool pre_recent(const PassContext& c, uint32_t src)
+{
+    if(c.recent)
+        return (std::atomic_ref<uint32_t>(c.recent[src>>5])
+                    .load(std::memory_order_relaxed) >> (src&31)) & 1u;
+    uint32_t lp = std::atomic_ref<uint32_t>(c.lastF[src]).load(std::memory_order_relaxed);
+    return c.now - lp <= kWindowPre;
+}
+
+/* before the weights of synapses [i0, i1] are written: a snapshot in
+   progress keeps their blocks' old weights first                      */
+inline void keep_frozen(const PassContext& c, uint64_t i0, uint64_t i1)
+{
+    if(!c.syn.frozen) return;
+    for(uint64_t b = i0 >> kDirtyShift; b <= (i1 >> kDirtyShift); ++b)
+        if(std::atomic_ref<uint8_t>(c.syn.frozen->state[b]).load(std::memory_order_acquire) < kFrozenSaved)
+            freeze_block(c.syn, b);
+}
+
+/* weight of synapse i written back */
+inline void mark_dirty(const PassContext& c, uint64_t i)
+{
+    if(c.syn.dirty)
+        std::atomic_ref<uint8_t>(c.syn.dirty[i >> kDirtyShift]).store(1, std::memory_order_relaxed);
+}
+
+/* E/I: dst was hit by an inhibitory synapse within kInhibit ticks */
+inline bool post_quiet(const PassContext& c, uint32_t dst)
+{
+    return (std::atomic_ref<uint32_t>(c.quiet[dst>>5])
+                .load(std::memory_order_relaxed) >> (dst&31)) & 1u;
+}
+
+/* commit an inhibitory hit: lastInhibit and the quiet bit */
+inline void commit_inhibit(const PassContext& c, uint32_t dst)
+{
+    std::atomic_ref<uint32_t>(c.lastI[dst]).store(c.now, std::memory_order_relaxed);
+    std::atomic_ref<uint32_t>(c.quiet[dst>>5]).fetch_or(1u<<(dst&31),
+                                                        std::memory_order_relaxed);
+}
+
+/* commit a spike: lastFired and, if kept, the recent bit */
+inline void commit_spike(const PassContext& c, uint32_t dst)
+{
+    std::atomic_ref<uint32_t>(c.lastF[dst]).store(c.now, std::memory_order_relaxed);
+    if(c.recent)
+        std::atomic_ref<uint32_t>(c.recent[dst>>5]).fetch_or(1u<<(dst&31),
+                                                             std::memory_order_relaxed);
+}
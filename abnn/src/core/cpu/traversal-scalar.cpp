@@ -0,0 +1,169 @@
+// traversal-scalar.cpp  –  reference CPU kernels (one synapse per step)
+// ======================================================================
+
+#include "traversal-kernels.h"
+
+#include <algorithm>
+
+/* layout accessors ----------------------------------------------------- */
+struct PackedAccess
+{
+    SynapsePacked* s;
+    uint32_t src(uint64_t i) const { return s[i].src; }
+    uint32_t dst(uint64_t i) const { return s[i].dst; }
+    float    w  (uint64_t i) const { return s[i].w;   }
+    void     put(uint64_t i, float w, uint32_t) const { s[i].w = w; }
+};
+
+template<WeightFormat F>
+struct SoAAccess
+{
+    const SynapseView& v;
+    uint32_t src(uint64_t i) const { return v.src[i]; }
+    uint32_t dst(uint64_t i) const { return v.dst[i]; }
+    float w(uint64_t i) const
+    {
+        if constexpr (F==WeightFormat::F16)  return decode_f16(v.w16[i]);
+        if constexpr (F==WeightFormat::BF16) return decode_bf16(v.w16[i]);
+        if constexpr (F==WeightFormat::U8)   return decode_u8(v.w8[i], v.wLo, v.wStep);
+        if constexpr (F==WeightFormat::F32)  return v.w[i];
+    }
+    void put(uint64_t i, float w, uint32_t r) const
+    {
+        if constexpr (F==WeightFormat::F16)  v.w16[i] = encode_f16(w, r);
+        if constexpr (F==WeightFormat::BF16) v.w16[i] = encode_bf16(w, r);
+        if constexpr (F==WeightFormat::U8)   v.w8[i]  = encode_u8(w, v.wLo, 1.0f/v.wStep, r);
+        if constexpr (F==WeightFormat::F32)  v.w[i]   = w;
+    }
+};
+
+/* plasticity + reward + homeostasis for one visited synapse --------- */
+template<class A>
+static inline void update(const PassContext& c, const A& a, uint64_t i,
+                          float w, uint32_t ld, bool fire, uint32_t rnd)
+{
+    float dW = fire ?  (c.pp.aLTP * (1.f - w))
+                    : (-c.pp.aLTD * w);
+    dW += kEtaReward * (c.R - c.rBar) * (fire ? 1.0f : 0.0f);
+
+    float isi   = float(c.now - ld);
+    float estHz = isi > 0.f ? 1e6f / isi : 0.f;
+    dW += kEtaHome * (kTargetRateHz - estHz) * w;
+
+    keep_frozen(c, i, i);
+    a.put(i, std::clamp(w + dW, c.pp.wMin, c.pp.wMax), rnd);
+    mark_dirty(c, i);
+}
+
+/* ===================================================================== */
+template<SynapseKind K, class A>
+static RangeCounts traverse(const PassContext& c, const A& a, uint64_t b, uint64_t e)
+{
+    constexpr bool kInh = K==SynapseKind::Inh;
+    uint64_t gated=0, fired=0;
+
+    for(uint64_t i=b; i<e; ++i){
+        /* ---------- gating ----------------------------------------- */
+        const uint32_t src = a.src(i);
+        if(src==kFreeSyn || !pre_recent(c, src)) continue;
+
+        const uint32_t dst = a.dst(i);
+        uint32_t ld = std::atomic_ref<uint32_t>(c.lastF[dst])
+                          .load(std::memory_order_relaxed);
+        if(c.now - ld <= kRefractory) continue;
+        if constexpr (K==SynapseKind::Exc) if(post_quiet(c, dst)) continue;
+
+        if(!kInh && !c.cand && c.budget->exhausted(c.worker)) continue;
+        ++gated;
+
+        const float w = a.w(i);
+
+        /* probability ---------------------------------------------- */
+        float p    = std::clamp(w * w * kind_scale<K>(), 0.f, 1.f);
+        const Philox4 r = philox(c.key, philox_counter(i, c.pass, kStreamSynapse));
+        bool  fire = (p > philox_u01(r.v[0]));
+
+        if(c.cand){                                   /* scan mode */
+            c.cand->push_back({ i, dst, ld, r.v[1], fire, kInh });
+            fired += fire;
+            continue;
+        }
+        if(!kInh && fire) fire = c.budget->take(c.worker);
+
+        update(c, a, i, w, ld, fire, r.v[1]);
+
+        if(fire){
+            if constexpr (kInh) commit_inhibit(c, dst);
+            else                commit_spike(c, dst);
+            ++fired;
+        }
+    }
+    return kInh ? RangeCounts{ gated, 0, fired } : RangeCounts{ gated, fired, 0 };
+}
+
+/* candidates of one chunk, in scan order: inhibitory ones take no
+   budget and are all applied, excitatory ones only while it lasts ---- */
+template<class A>
+static RangeCounts commit(const PassContext& c, const A& a,
+                          const Candidate* cand, uint64_t n, uint32_t budget)
+{
+    uint64_t gated=0, fired=0, inhibited=0;
+
+    for(uint64_t k=0; k<n; ++k){
+        const Candidate& x = cand[k];
+        if(!x.inh && !budget) continue;
+        const bool fire = x.want;
+        ++gated;
+
+        update(c, a, x.i, a.w(x.i), x.ld, fire, x.rnd);
+
+        if(x.inh){
+            if(fire){ commit_inhibit(c, x.dst); ++inhibited; }
+            continue;
+        }
+        budget -= fire;
+        if(fire){
+            commit_spike(c, x.dst);
+            ++fired;
+        }
+    }
+    return { gated, fired, inhibited };
+}
+
+/* ===================================================================== */
+template<SynapseKind K>
+RangeCounts traverse_scalar(const PassContext& c, uint64_t b, uint64_t e)
+{
+    return traverse<K>(c, PackedAccess{ c.syn.pk }, b, e);
+}
+
+template<SynapseKind K>
+RangeCounts traverse_scalar_soa(const PassContext& c, uint64_t b, uint64_t e)
+{
+    switch(c.syn.wfmt){
+        case WeightFormat::F16:  return traverse<K>(c, SoAAccess<WeightFormat::F16 >{ c.syn }, b, e);
+        case WeightFormat::BF16: return traverse<K>(c, SoAAccess<WeightFormat::BF16>{ c.syn }, b, e);
+        case WeightFormat::U8:   return traverse<K>(c, SoAAccess<WeightFormat::U8  >{ c.syn }, b, e);
+        default:                 return traverse<K>(c, SoAAccess<WeightFormat::F32 >{ c.syn }, b, e);
+    }
+}
+
+template RangeCounts traverse_scalar    <SynapseKind::Plain>(const PassContext&, uint64_t, uint64_t);
+template RangeCounts traverse_scalar    <SynapseKind::Exc  >(const PassContext&, uint64_t, uint64_t);
+template RangeCounts traverse_scalar    <SynapseKind::Inh  >(const PassContext&, uint64_t, uint64_t);
+template RangeCounts traverse_scalar_soa<SynapseKind::Plain>(const PassContext&, uint64_t, uint64_t);
+template RangeCounts traverse_scalar_soa<SynapseKind::Exc  >(const PassContext&, uint64_t, uint64_t);
+template RangeCounts traverse_scalar_soa<SynapseKind::Inh  >(const PassContext&, uint64_t, uint64_t);
+
+RangeCounts commit_candidates(const PassContext& c, const Candidate* cand,
+                              uint64_t n, uint32_t budget)
+{
+    if(c.syn.layout==SynapseLayout::Packed)
+        return commit(c, PackedAccess{ c.syn.pk }, cand, n, budget);
+    switch(c.syn.wfmt){
+        case WeightFormat::F16:  return commit(c, SoAAccess<WeightFormat::F16 >{ c.syn }, cand, n, budget);
+        case WeightFormat::BF16: return commit(c, SoAAccess<WeightFormat::BF16>{ c.syn }, cand, n, budget);
+        case WeightFormat::U8:   return commit(c, SoAAccess<WeightFormat::U8  >{ c.syn }, cand, n, budget);
+        default:                 return commit(c, SoAAccess<WeightFormat::F32 >{ c.syn }, cand, n, budget);
+    }
+}
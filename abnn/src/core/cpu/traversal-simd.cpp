@@ -0,0 +1,539 @@
+// traversal-simd.cpp  –  AVX2 / AVX-512 CPU kernels + runtime dispatch
+// ======================================================================
+// Packed blocks are transposed in-register, so lane j does not map to
+// synapse j: kLane8/kLane16 give the synapse offset of every lane. SoA
+// blocks load src[] directly (identity lanes) and only touch dst[]/w[]
+// when at least one lane has a live pre-synaptic spike. Gated lanes are
+// rare, so budget resolution walks their mask bits; everything else
+// stays vectorised. With a recent-spike bitmap the first gather reads
+// bitmap words (L2-resident) instead of lastFired.
+// Narrow SoA weights (fp16/bf16/u8) are widened after the pre-spike test
+// and re-encoded with stochastic rounding; their write-back goes lane by
+// lane (AVX2) or through a masked down-converting store (AVX-512).
+// Intra-block hazards (two lanes touching the same neuron) are resolved
+// the same way the GPU resolves concurrent threads: last store wins.
+// In scan mode (deterministic passes) the gated lanes are appended to
+// PassContext::cand in lane order and the block writes nothing.
+// The SynapseKind template parameter removes the E/I cases at compile
+// time: Exc adds one masked gather of quiet-bitmap words for the lanes
+// that passed the refractory gate, Inh skips the budget and commits its
+// hits to lastInhibit and the quiet bitmap instead of lastFired.
+
+#include "traversal-kernels.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#include "philox-simd.h"
+
+/* lane → synapse offset inside one block ------------------------------ */
+alignas(64) static const int32_t kLane8 [8]  = { 0,2,4,6, 1,3,5,7 };
+alignas(64) static const int32_t kLane16[16] = { 0,4,8,12, 1,5,9,13,
+                                                 2,6,10,14, 3,7,11,15 };
+alignas(64) static const int32_t kIdentity[16] = { 0,1,2,3, 4,5,6,7,
+                                                   8,9,10,11, 12,13,14,15 };
+
+/* budget for the gated lanes, in lane order -------------------------- */
+static inline void resolve_budget(const PassContext& c,
+                                  uint32_t gate, uint32_t want,
+                                  uint32_t& keep, uint32_t& fire)
+{
+    keep = fire = 0;
+    for(uint32_t bits=gate; bits; bits&=bits-1){
+        uint32_t j = __builtin_ctz(bits);
+        if(c.budget->exhausted(c.worker)) break;              /* never refills mid-pass */
+        keep |= 1u<<j;
+        if(((want>>j)&1u) && c.budget->take(c.worker)) fire |= 1u<<j;
+    }
+}
+
+/* scan mode: record the gated lanes of one block -------------------- */
+static inline RangeCounts push_candidates(const PassContext& c, uint64_t i,
+                                          const int32_t* lane, uint32_t gate,
+                                          uint32_t want, const uint32_t* d,
+                                          const uint32_t* l, const uint32_t* rnd,
+                                          bool inh)
+{
+    for(uint32_t bits=gate; bits; bits&=bits-1){
+        uint32_t j = __builtin_ctz(bits);
+        c.cand->push_back({ i+uint64_t(lane[j]), d[j], l[j], rnd[j], bool((want>>j)&1u), inh });
+    }
+    const uint64_t n = __builtin_popcount(gate), hit = __builtin_popcount(gate&want);
+    return { n, inh ? 0 : hit, inh ? hit : 0 };
+}
+
+/* spikes or inhibitory hits of the fire lanes, in lane order */
+template<SynapseKind K>
+static inline void commit_lanes(const PassContext& c, uint32_t fire, const uint32_t* d)
+{
+    for(uint32_t bits=fire; bits; bits&=bits-1){
+        if constexpr (K==SynapseKind::Inh) commit_inhibit(c, d[__builtin_ctz(bits)]);
+        else                               commit_spike  (c, d[__builtin_ctz(bits)]);
+    }
+}
+
+/* ===================================================================== */
+/* AVX2 – 8 synapses per iteration                                       */
+
+ABNN_AVX2 static inline __m256i le_epu32(__m256i a, __m256i b)
+{
+    return _mm256_cmpeq_epi32(_mm256_min_epu32(a,b), a);
+}
+
+/* exact uint32 → float (AVX2 only converts signed) */
+ABNN_AVX2 static inline __m256 cvt_u32_ps(__m256i x)
+{
+    __m256 hi = _mm256_cvtepi32_ps(_mm256_srli_epi32(x,16));
+    __m256 lo = _mm256_cvtepi32_ps(_mm256_and_si256(x,_mm256_set1_epi32(0xFFFF)));
+    return _mm256_add_ps(_mm256_mul_ps(hi,_mm256_set1_ps(65536.f)), lo);
+}
+
+/* SoA weight load / stochastic-rounding store, one variant per format */
+template<WeightFormat F>
+ABNN_AVX2 static inline __m256 avx2_load_w(const SynapseView& v, uint64_t i)
+{
+    if constexpr (F==WeightFormat::F16)
+        return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v.w16+i)));
+    if constexpr (F==WeightFormat::BF16)
+        return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(
+                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(v.w16+i))), 16));
+    if constexpr (F==WeightFormat::U8)
+        return _mm256_add_ps(_mm256_set1_ps(v.wLo), _mm256_mul_ps(_mm256_set1_ps(v.wStep),
+                   _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
+                   _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v.w8+i))))));
+    if constexpr (F==WeightFormat::F32)
+        return _mm256_loadu_ps(v.w+i);
+}
+
+template<WeightFormat F>
+ABNN_AVX2 static inline void avx2_store_w(const SynapseView& v, uint64_t i,
+                                          __m256 w, __m256i rb, uint32_t keep)
+{
+    if constexpr (F==WeightFormat::F32) {
+        const __m256i vBit = _mm256_setr_epi32(1,2,4,8,16,32,64,128);
+        __m256i kM = _mm256_cmpeq_epi32(
+                         _mm256_and_si256(_mm256_set1_epi32((int)keep), vBit), vBit);
+        _mm256_maskstore_ps(v.w+i, kM, w);
+    } else if constexpr (F==WeightFormat::U8) {
+        __m256 q = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(w,_mm256_set1_ps(v.wLo)),
+                                               _mm256_set1_ps(1.0f/v.wStep)),
+                                 _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(rb,8)),
+                                               _mm256_set1_ps(1.0f/16777216.0f)));
+        __m256i qi = _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_max_ps(q,_mm256_setzero_ps())),
+                                      _mm256_set1_epi32(255));
+        alignas(32) uint32_t out[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(out), qi);
+        for(uint32_t bits=keep; bits; bits&=bits-1){
+            uint32_t j = __builtin_ctz(bits);
+            v.w8[i+j] = uint8_t(out[j]);
+        }
+    } else {
+        alignas(16) uint16_t out[8];
+        if constexpr (F==WeightFormat::F16) {
+            __m256 x = _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(w),
+                                                            _mm256_srli_epi32(rb,19)));
+            _mm_store_si128(reinterpret_cast<__m128i*>(out),
+                            _mm256_cvtps_ph(x, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC));
+        } else {
+            __m256i h = _mm256_srli_epi32(_mm256_add_epi32(_mm256_castps_si256(w),
+                                                           _mm256_srli_epi32(rb,16)), 16);
+            h = _mm256_permute4x64_epi64(_mm256_packus_epi32(h,h), 0x08);
+            _mm_store_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(h));
+        }
+        for(uint32_t bits=keep; bits; bits&=bits-1){
+            uint32_t j = __builtin_ctz(bits);
+            v.w16[i+j] = out[j];
+        }
+    }
+}
+
+template<SynapseKind K, bool kSoA, WeightFormat kW = WeightFormat::F32>
+ABNN_AVX2 static RangeCounts avx2_impl(const PassContext& c, uint64_t b, uint64_t e)
+{
+    constexpr bool kInh = K==SynapseKind::Inh;
+    const __m256i vNow  = _mm256_set1_epi32((int)c.now);
+    const __m256i vWin  = _mm256_set1_epi32((int)kWindowPre);
+    const __m256i vRef  = _mm256_set1_epi32((int)kRefractory);
+    const __m256i vLane = kSoA ? _mm256_setr_epi32(0,1,2,3,4,5,6,7)
+                               : _mm256_load_si256(reinterpret_cast<const __m256i*>(kLane8));
+    const __m256i vBit  = _mm256_setr_epi32(1,2,4,8,16,32,64,128);
+    const __m256  vZero = _mm256_setzero_ps();
+    const __m256  vOne  = _mm256_set1_ps(1.f);
+    const __m256i vOneI = _mm256_set1_epi32(1);
+    const __m256i vFree = _mm256_set1_epi32((int)kFreeSyn);
+    const int*    lastF = reinterpret_cast<const int*>(c.lastF);
+    const int*    recent = reinterpret_cast<const int*>(c.recent);
+    const int*    quiet = reinterpret_cast<const int*>(c.quiet);
+
+    uint64_t gated=0, fired=0, i=b;
+    for(; i+8<=e; i+=8){
+        __m256i src, dst;
+        __m256  w;
+
+        /* ---------- load ------------------------------------------- */
+        if constexpr (kSoA) {
+            src = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c.syn.src+i));
+        } else {
+            /* 4x4 transpose per 128-bit half */
+            const __m256i* p = reinterpret_cast<const __m256i*>(c.syn.pk+i);
+            __m256i v0=_mm256_loadu_si256(p),   v1=_mm256_loadu_si256(p+1),
+                    v2=_mm256_loadu_si256(p+2), v3=_mm256_loadu_si256(p+3);
+            __m256i t0=_mm256_unpacklo_epi32(v0,v1), t1=_mm256_unpackhi_epi32(v0,v1),
+                    t2=_mm256_unpacklo_epi32(v2,v3), t3=_mm256_unpackhi_epi32(v2,v3);
+            src=_mm256_unpacklo_epi64(t0,t2);
+            dst=_mm256_unpackhi_epi64(t0,t2);
+            w  =_mm256_castsi256_ps(_mm256_unpacklo_epi64(t1,t3));
+        }
+
+        /* ---------- gating (free slots never gather) --------------- */
+        const __m256i live = _mm256_xor_si256(_mm256_cmpeq_epi32(src, vFree), vFree);
+        __m256i pre;
+        if(c.recent){
+            __m256i wd = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), recent,
+                                                     _mm256_srli_epi32(src,5), live, 4);
+            __m256i sh = _mm256_and_si256(src, _mm256_set1_epi32(31));
+            pre = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_srlv_epi32(wd,sh), vOneI), vOneI);
+        } else {
+            __m256i lp = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), lastF, src, live, 4);
+            pre = _mm256_and_si256(le_epu32(_mm256_sub_epi32(vNow,lp), vWin), live);
+        }
+        if(_mm256_testz_si256(pre,pre)) continue;
+
+        if constexpr (kSoA) {
+            dst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c.syn.dst+i));
+            w   = avx2_load_w<kW>(c.syn, i);
+        }
+
+        __m256i ld    = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(),
+                                                    lastF, dst, pre, 4);
+        __m256i dPost = _mm256_sub_epi32(vNow, ld);
+        __m256i gate  = _mm256_andnot_si256(le_epu32(dPost,vRef), pre);
+        if constexpr (K==SynapseKind::Exc) {
+            __m256i qw = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), quiet,
+                                                     _mm256_srli_epi32(dst,5), gate, 4);
+            __m256i sh = _mm256_and_si256(dst, _mm256_set1_epi32(31));
+            gate = _mm256_andnot_si256(_mm256_cmpeq_epi32(
+                       _mm256_and_si256(_mm256_srlv_epi32(qw,sh), vOneI), vOneI), gate);
+        }
+        uint32_t mGate = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(gate));
+        if(!mGate) continue;
+
+        /* ---------- probability vs Philox word 0 ------------------- */
+        __m256  pr  = _mm256_min_ps(_mm256_max_ps(
+                          _mm256_mul_ps(_mm256_mul_ps(w,w), _mm256_set1_ps(kind_scale<K>())),
+                          vZero), vOne);
+        __m256i r0, r1, r2, r3;
+        philox_counters_avx2(philox_counter(i, c.pass, kStreamSynapse), vLane, r0, r1, r2, r3);
+        philox_avx2(c.key, r0, r1, r2, r3);
+        __m256  r   = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(r0,8)),
+                                    _mm256_set1_ps(1.0f/16777216.0f));
+        uint32_t mWant = (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(pr, r, _CMP_GT_OQ));
+
+        if(c.cand){                                   /* scan mode */
+            alignas(32) uint32_t d[8], l[8], rb[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(d),  dst);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(l),  ld);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(rb), r1);
+            RangeCounts rc = push_candidates(c, i, kSoA ? kIdentity : kLane8,
+                                             mGate, mWant, d, l, rb, kInh);
+            gated += rc.gated; fired += rc.fired + rc.inhibited;
+            continue;
+        }
+
+        uint32_t keep = mGate, fire = mGate & mWant;      /* hits take no token */
+        if constexpr (!kInh) resolve_budget(c, mGate, mWant, keep, fire);
+        if(!keep) continue;
+
+        /* ---------- plasticity + reward + homeostasis -------------- */
+        __m256 fM  = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+                         _mm256_and_si256(_mm256_set1_epi32((int)fire), vBit), vBit));
+        __m256 dW  = _mm256_blendv_ps(_mm256_mul_ps(_mm256_set1_ps(-c.pp.aLTD), w),
+                                      _mm256_mul_ps(_mm256_set1_ps(c.pp.aLTP), _mm256_sub_ps(vOne,w)),
+                                      fM);
+        dW = _mm256_add_ps(dW, _mm256_and_ps(fM, _mm256_set1_ps(kEtaReward*(c.R-c.rBar))));
+
+        __m256 isi = cvt_u32_ps(dPost);
+        __m256 est = _mm256_and_ps(_mm256_cmp_ps(isi, vZero, _CMP_GT_OQ),
+                                   _mm256_div_ps(_mm256_set1_ps(1e6f), isi));
+        dW = _mm256_add_ps(dW, _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(kEtaHome),
+                               _mm256_sub_ps(_mm256_set1_ps(kTargetRateHz), est)), w));
+
+        __m256 wNew = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(w,dW),
+                                    _mm256_set1_ps(c.pp.wMin)), _mm256_set1_ps(c.pp.wMax));
+
+        /* ---------- masked write-back ------------------------------ */
+        if(keep) keep_frozen(c, i, i+7);
+        if constexpr (kSoA) {
+            avx2_store_w<kW>(c.syn, i, wNew, r1, keep);
+        } else {
+            alignas(32) float wOut[8];
+            _mm256_store_ps(wOut, wNew);
+            for(uint32_t bits=keep; bits; bits&=bits-1){
+                uint32_t j = __builtin_ctz(bits);
+                c.syn.pk[i + kLane8[j]].w = wOut[j];
+            }
+        }
+        if(keep){ mark_dirty(c, i); mark_dirty(c, i+7); }
+
+        alignas(32) uint32_t dOut[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(dOut), dst);
+        commit_lanes<K>(c, fire, dOut);
+        gated += __builtin_popcount(keep);
+        fired += __builtin_popcount(fire);
+    }
+
+    RangeCounts tail = kSoA ? traverse_scalar_soa<K>(c, i, e) : traverse_scalar<K>(c, i, e);
+    return kInh ? RangeCounts{ gated+tail.gated, 0, fired+tail.inhibited }
+                : RangeCounts{ gated+tail.gated, fired+tail.fired, 0 };
+}
+
+template<SynapseKind K>
+RangeCounts traverse_avx2(const PassContext& c, uint64_t b, uint64_t e){ return avx2_impl<K, false>(c,b,e); }
+
+template<SynapseKind K>
+RangeCounts traverse_avx2_soa(const PassContext& c, uint64_t b, uint64_t e)
+{
+    switch(c.syn.wfmt){
+        case WeightFormat::F16:  return avx2_impl<K, true, WeightFormat::F16 >(c,b,e);
+        case WeightFormat::BF16: return avx2_impl<K, true, WeightFormat::BF16>(c,b,e);
+        case WeightFormat::U8:   return avx2_impl<K, true, WeightFormat::U8  >(c,b,e);
+        default:                 return avx2_impl<K, true, WeightFormat::F32 >(c,b,e);
+    }
+}
+
+/* ===================================================================== */
+/* AVX-512 – 16 synapses per iteration                                   */
+
+template<WeightFormat F>
+ABNN_AVX512 static inline __m512 avx512_load_w(const SynapseView& v, uint64_t i)
+{
+    if constexpr (F==WeightFormat::F16)
+        return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(v.w16+i)));
+    if constexpr (F==WeightFormat::BF16)
+        return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(
+                   _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v.w16+i))), 16));
+    if constexpr (F==WeightFormat::U8)
+        return _mm512_add_ps(_mm512_set1_ps(v.wLo), _mm512_mul_ps(_mm512_set1_ps(v.wStep),
+                   _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(
+                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(v.w8+i))))));
+    if constexpr (F==WeightFormat::F32)
+        return _mm512_loadu_ps(v.w+i);
+}
+
+template<WeightFormat F>
+ABNN_AVX512 static inline void avx512_store_w(const SynapseView& v, uint64_t i,
+                                              __m512 w, __m512i rb, __mmask16 keep)
+{
+    if constexpr (F==WeightFormat::F32) {
+        _mm512_mask_storeu_ps(v.w+i, keep, w);
+    } else if constexpr (F==WeightFormat::U8) {
+        __m512 q = _mm512_add_ps(_mm512_mul_ps(_mm512_sub_ps(w,_mm512_set1_ps(v.wLo)),
+                                               _mm512_set1_ps(1.0f/v.wStep)),
+                                 _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_srli_epi32(rb,8)),
+                                               _mm512_set1_ps(1.0f/16777216.0f)));
+        __m512i qi = _mm512_min_epi32(_mm512_cvttps_epi32(_mm512_max_ps(q,_mm512_setzero_ps())),
+                                      _mm512_set1_epi32(255));
+        _mm512_mask_cvtepi32_storeu_epi8(v.w8+i, keep, qi);
+    } else if constexpr (F==WeightFormat::F16) {
+        __m512 x = _mm512_castsi512_ps(_mm512_add_epi32(_mm512_castps_si512(w),
+                                                        _mm512_srli_epi32(rb,19)));
+        __m256i h = _mm512_cvtps_ph(x, _MM_FROUND_TO_ZERO|_MM_FROUND_NO_EXC);
+        _mm512_mask_cvtepi32_storeu_epi16(v.w16+i, keep, _mm512_cvtepu16_epi32(h));
+    } else {
+        __m512i h = _mm512_srli_epi32(_mm512_add_epi32(_mm512_castps_si512(w),
+                                                       _mm512_srli_epi32(rb,16)), 16);
+        _mm512_mask_cvtepi32_storeu_epi16(v.w16+i, keep, h);
+    }
+}
+
+template<SynapseKind K, bool kSoA, WeightFormat kW = WeightFormat::F32>
+ABNN_AVX512 static RangeCounts avx512_impl(const PassContext& c, uint64_t b, uint64_t e)
+{
+    constexpr bool kInh = K==SynapseKind::Inh;
+    const __m512i vNow  = _mm512_set1_epi32((int)c.now);
+    const __m512i vWin  = _mm512_set1_epi32((int)kWindowPre);
+    const __m512i vRef  = _mm512_set1_epi32((int)kRefractory);
+    const __m512i vLane = kSoA ? _mm512_setr_epi32(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15)
+                               : _mm512_load_si512(kLane16);
+    const __m512i vOffs = _mm512_slli_epi32(vLane, 2);      /* 4 words / synapse */
+    const __m512  vZero = _mm512_setzero_ps();
+    const __m512  vOne  = _mm512_set1_ps(1.f);
+
+    uint64_t gated=0, fired=0, i=b;
+    for(; i+16<=e; i+=16){
+        __m512i src, dst;
+        __m512  w;
+
+        /* ---------- load ------------------------------------------- */
+        if constexpr (kSoA) {
+            src = _mm512_loadu_si512(c.syn.src+i);
+        } else {
+            /* 4x4 transpose per 128-bit lane */
+            const __m512i* p = reinterpret_cast<const __m512i*>(c.syn.pk+i);
+            __m512i v0=_mm512_loadu_si512(p),   v1=_mm512_loadu_si512(p+1),
+                    v2=_mm512_loadu_si512(p+2), v3=_mm512_loadu_si512(p+3);
+            __m512i t0=_mm512_unpacklo_epi32(v0,v1), t1=_mm512_unpackhi_epi32(v0,v1),
+                    t2=_mm512_unpacklo_epi32(v2,v3), t3=_mm512_unpackhi_epi32(v2,v3);
+            src=_mm512_unpacklo_epi64(t0,t2);
+            dst=_mm512_unpackhi_epi64(t0,t2);
+            w  =_mm512_castsi512_ps(_mm512_unpacklo_epi64(t1,t3));
+        }
+
+        /* ---------- gating (free slots never gather) --------------- */
+        const __mmask16 live = _mm512_cmpneq_epi32_mask(src, _mm512_set1_epi32((int)kFreeSyn));
+        __mmask16 pre;
+        if(c.recent){
+            __m512i wd = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), live,
+                                                     _mm512_srli_epi32(src,5), c.recent, 4);
+            __m512i sh = _mm512_and_si512(src, _mm512_set1_epi32(31));
+            pre = _mm512_mask_test_epi32_mask(live, _mm512_srlv_epi32(wd,sh), _mm512_set1_epi32(1));
+        } else {
+            __m512i lp = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), live, src, c.lastF, 4);
+            pre = _mm512_mask_cmple_epu32_mask(live, _mm512_sub_epi32(vNow,lp), vWin);
+        }
+        if(!pre) continue;
+
+        if constexpr (kSoA) {
+            dst = _mm512_loadu_si512(c.syn.dst+i);
+            w   = avx512_load_w<kW>(c.syn, i);
+        }
+
+        __m512i   ld    = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), pre,
+                                                      dst, c.lastF, 4);
+        __m512i   dPost = _mm512_sub_epi32(vNow, ld);
+        __mmask16 gate  = _mm512_mask_cmpgt_epu32_mask(pre, dPost, vRef);
+        if constexpr (K==SynapseKind::Exc) {
+            __m512i qw = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), gate,
+                                                     _mm512_srli_epi32(dst,5), c.quiet, 4);
+            __m512i sh = _mm512_and_si512(dst, _mm512_set1_epi32(31));
+            gate = _mm512_mask_testn_epi32_mask(gate, _mm512_srlv_epi32(qw,sh), _mm512_set1_epi32(1));
+        }
+        if(!gate) continue;
+
+        /* ---------- probability vs Philox word 0 ------------------- */
+        __m512  pr  = _mm512_min_ps(_mm512_max_ps(
+                          _mm512_mul_ps(_mm512_mul_ps(w,w), _mm512_set1_ps(kind_scale<K>())),
+                          vZero), vOne);
+        __m512i r0, r1, r2, r3;
+        philox_counters_avx512(philox_counter(i, c.pass, kStreamSynapse), vLane, r0, r1, r2, r3);
+        philox_avx512(c.key, r0, r1, r2, r3);
+        __m512  r   = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_srli_epi32(r0,8)),
+                                    _mm512_set1_ps(1.0f/16777216.0f));
+        __mmask16 want = _mm512_mask_cmp_ps_mask(gate, pr, r, _CMP_GT_OQ);
+
+        if(c.cand){                                   /* scan mode */
+            alignas(64) uint32_t d[16], l[16], rb[16];
+            _mm512_store_si512(d,  dst);
+            _mm512_store_si512(l,  ld);
+            _mm512_store_si512(rb, r1);
+            RangeCounts rc = push_candidates(c, i, kSoA ? kIdentity : kLane16,
+                                             gate, want, d, l, rb, kInh);
+            gated += rc.gated; fired += rc.fired + rc.inhibited;
+            continue;
+        }
+
+        uint32_t keep = gate, fire = want;                /* hits take no token */
+        if constexpr (!kInh) resolve_budget(c, gate, want, keep, fire);
+        if(!keep) continue;
+
+        /* ---------- plasticity + reward + homeostasis -------------- */
+        __m512 dW = _mm512_mask_blend_ps((__mmask16)fire,
+                        _mm512_mul_ps(_mm512_set1_ps(-c.pp.aLTD), w),
+                        _mm512_mul_ps(_mm512_set1_ps(c.pp.aLTP), _mm512_sub_ps(vOne,w)));
+        dW = _mm512_mask_add_ps(dW, (__mmask16)fire, dW,
+                                _mm512_set1_ps(kEtaReward*(c.R-c.rBar)));
+
+        __m512 isi = _mm512_cvtepu32_ps(dPost);
+        __m512 est = _mm512_maskz_div_ps(_mm512_cmp_ps_mask(isi, vZero, _CMP_GT_OQ),
+                                         _mm512_set1_ps(1e6f), isi);
+        dW = _mm512_add_ps(dW, _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(kEtaHome),
+                               _mm512_sub_ps(_mm512_set1_ps(kTargetRateHz), est)), w));
+
+        __m512 wNew = _mm512_min_ps(_mm512_max_ps(_mm512_add_ps(w,dW),
+                                    _mm512_set1_ps(c.pp.wMin)), _mm512_set1_ps(c.pp.wMax));
+
+        /* ---------- masked write-back ------------------------------ */
+        if(keep) keep_frozen(c, i, i+15);
+        if constexpr (kSoA)
+            avx512_store_w<kW>(c.syn, i, wNew, r1, (__mmask16)keep);
+        else
+            _mm512_mask_i32scatter_ps(&c.syn.pk[i].w, (__mmask16)keep, vOffs, wNew, 4);
+        if(keep){ mark_dirty(c, i); mark_dirty(c, i+15); }
+        _mm512_mask_i32scatter_epi32(kInh ? c.lastI : c.lastF, (__mmask16)fire, dst, vNow, 4);
+        uint32_t* bitmap = kInh ? c.quiet : c.recent;
+        if(bitmap && fire){
+            alignas(64) uint32_t d[16];
+            _mm512_store_si512(d, dst);
+            for(uint32_t bits=fire; bits; bits&=bits-1){
+                uint32_t n = d[__builtin_ctz(bits)];
+                std::atomic_ref<uint32_t>(bitmap[n>>5]).fetch_or(1u<<(n&31),
+                                                                 std::memory_order_relaxed);
+            }
+        }
+
+        gated += __builtin_popcount(keep);
+        fired += __builtin_popcount(fire);
+    }
+
+    RangeCounts tail = kSoA ? traverse_scalar_soa<K>(c, i, e) : traverse_scalar<K>(c, i, e);
+    return kInh ? RangeCounts{ gated+tail.gated, 0, fired+tail.inhibited }
+                : RangeCounts{ gated+tail.gated, fired+tail.fired, 0 };
+}
+
+template<SynapseKind K>
+RangeCounts traverse_avx512(const PassContext& c, uint64_t b, uint64_t e){ return avx512_impl<K, false>(c,b,e); }
+
+template<SynapseKind K>
+RangeCounts traverse_avx512_soa(const PassContext& c, uint64_t b, uint64_t e)
+{
+    switch(c.syn.wfmt){
+        case WeightFormat::F16:  return avx512_impl<K, true, WeightFormat::F16 >(c,b,e);
+        case WeightFormat::BF16: return avx512_impl<K, true, WeightFormat::BF16>(c,b,e);
+        case WeightFormat::U8:   return avx512_impl<K, true, WeightFormat::U8  >(c,b,e);
+        default:                 return avx512_impl<K, true, WeightFormat::F32 >(c,b,e);
+    }
+}
+#endif /* __x86_64__ */
+
+/* ===================================================================== */
+/* runtime dispatch                                                      */
+SimdLevel detect_simd_level()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")) return SimdLevel::Avx512;
+    if(__builtin_cpu_supports("avx2") &&
+       __builtin_cpu_supports("f16c"))    return SimdLevel::Avx2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+const char* simd_level_name(SimdLevel l)
+{
+    switch(l){
+        case SimdLevel::Avx512: return "AVX-512";
+        case SimdLevel::Avx2:   return "AVX2";
+        default:                return "scalar";
+    }
+}
+
+template<SynapseKind K>
+static RangeKernel select_kind(SimdLevel l, bool soa)
+{
+    switch(l){
+#if defined(__x86_64__)
+        case SimdLevel::Avx512: return soa ? traverse_avx512_soa<K> : traverse_avx512<K>;
+        case SimdLevel::Avx2:   return soa ? traverse_avx2_soa<K>   : traverse_avx2<K>;
+#endif
+        default:                return soa ? traverse_scalar_soa<K> : traverse_scalar<K>;
+    }
+}
+
+RangeKernel select_kernel(SimdLevel l, SynapseLayout layout, SynapseKind k)
+{
+    const bool soa = layout==SynapseLayout::SoA;
+    switch(k){
+        case SynapseKind::Exc: return select_kind<SynapseKind::Exc>(l, soa);
+        case SynapseKind::Inh: return select_kind<SynapseKind::Inh>(l, soa);
+        default:               return select_kind<SynapseKind::Plain>(l, soa);
+    }
+}
@@ -11,19 +11,34 @@ using namespace metal;
 struct SynapsePacked { uint src, dst; float w, pad; };
 
 /* ------------------------------------------------------------
-   RNG helper: 32-bit xorshift -> [0,1) float                */
-inline float rand01(uint s)
+   RNG: Philox4x32-10, counter (index, stream, pass) – same
+   function as core/cpu/philox.h, so CPU and GPU draw alike  */
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+inline uint4 philox(uint4 c, uint2 k)
 {
-    s ^= s << 13;  s ^= s >> 17;  s ^= s << 5;
-    return (float)(s & 0xFFFFFF) * (1.0f / 16777216.0f);
+    for (int r = 0; r < 10; ++r) {
+        uint hi0 = mulhi(PHILOX_M0, c.x), lo0 = PHILOX_M0 * c.x;
+        uint hi1 = mulhi(PHILOX_M1, c.z), lo1 = PHILOX_M1 * c.z;
+        c  = uint4(hi1 ^ c.y ^ k.x, lo1, hi0 ^ c.w ^ k.y, lo0);
+        k += uint2(PHILOX_W0, PHILOX_W1);
+    }
+    return c;
 }
 
+/* top 24 bits -> [0,1) float */
+inline float philox_u01(uint x) { return (float)(x >> 8) * (1.0f / 16777216.0f); }
+
 /* ------------- build-time knobs --------------------------- */
 #define BASE_SCALE     0.8f      /* p = w² · BASE_SCALE                 */
 #define REFRACTORY      2u       /* dst silent window [ticks]           */
 #define WINDOW_PRE      5u       /* pre spike valid window              */
 #define MAX_SPIKES    128u       /* global budget per kernel pass       */
 #define CLOCK_INC       1u       /* add per synapse                      */
+#define FREE_SYN 0xFFFFFFFFu     /* src of a free slot: never gated      */
 
 #define TARGET_RATE_HZ 1000.0f   /* homeostatic set-point               */
 #define ETA_HOME      1.0e-6f    /* homeostasis learning rate           */
@@ -53,6 +68,8 @@ kernel void monte_carlo_traversal(
     device atomic_uint*  budget       [[buffer(11)]],
     device const float*  reward       [[buffer(12)]],       /* scalar 0/1 */
     device atomic_float* rBarA        [[buffer(13)]],       /* running avg */
+    constant uint2&      pass         [[buffer(14)]],       /* lo, hi      */
+    constant uint2&      seed         [[buffer(15)]],       /* Philox key  */
     uint3                tPos         [[thread_position_in_threadgroup]],
     uint3                gPos         [[thread_position_in_grid]],
     uint3                tgSize       [[threads_per_threadgroup]])
@@ -70,7 +87,8 @@ kernel void monte_carlo_traversal(
     SynapsePacked s = syn[tid];
 
     /* ---------- gating ------------------------------------------- */
-    uint lp = atomic_load_explicit(&lastF[s.src], memory_order_relaxed);
+    uint lp = s.src != FREE_SYN ? atomic_load_explicit(&lastF[s.src], memory_order_relaxed)
+                                : now - WINDOW_PRE - 1u;
     if (now - lp > WINDOW_PRE) {
         if (tid == 0) atomic_fetch_add_explicit(clock, CLOCK_INC, memory_order_relaxed);
         return;
@@ -89,7 +107,8 @@ kernel void monte_carlo_traversal(
 
     /* probability -------------------------------------------------- */
     float p     = clamp(s.w * s.w * BASE_SCALE, 0.f, 1.f);
-    bool  fired = (p > rand01(tid ^ now));
+    uint4 rnd   = philox(uint4(tid, 0u /* stream 0: synapses */, pass.x, pass.y), seed);
+    bool  fired = (p > philox_u01(rnd.x));
 
     /* global budget ------------------------------------------------ */
     if (fired) {
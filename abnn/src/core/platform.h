@@ -0,0 +1,18 @@
+#pragma once
+/* platform.h  –  execution backend selection
+ * =====================================================================
+ *   ABNN_METAL = 1  Apple build: Metal pipelines + CPU backend
+ *   ABNN_METAL = 0  everything else: CPU backend only (Linux servers)
+ *
+ * Define ABNN_FORCE_CPU to build the CPU-only configuration on macOS.
+ */
+
+#if defined(__APPLE__) && !defined(ABNN_FORCE_CPU)
+#define ABNN_METAL 1
+#else
+#define ABNN_METAL 0
+#endif
+
+#if ABNN_METAL
+#include <Metal/Metal.hpp>
+#endif
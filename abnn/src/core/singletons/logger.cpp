@@ -82,3 +82,66 @@ void Logger::flush()
     else
         mat_ << "% ABNN animated session\n";
 }
+
+/* CPU backend throughput ------------------------------------------------- */
+void Logger::log_pass_stats(const TraversalStats& s, uint32_t nPasses)
+{
+    statsAcc_ += s;
+    statsN_   += nPasses;
+    if(statsN_ < kStatsEvery) return;
+
+    const auto   t1   = std::chrono::steady_clock::now();
+    const double sec  = statsAcc_.seconds > 0.0 ? statsAcc_.seconds : 1e-9;
+    const double wall = std::chrono::duration<double>(t1 - statsT0_).count();
+    std::cout << "⚡ " << statsAcc_.visited / sec * 1e-6 << " M syn/s, "
+              << statsN_ / sec << " passes/s ("
+              << statsN_ / (wall > 0.0 ? wall : 1e-9) << " wall), "
+              << double(statsAcc_.fired) / statsN_ << " spikes/pass, "
+              << double(statsAcc_.gated) / statsN_ << " gated/pass, "
+              << 100.0 * double(statsAcc_.saturated) / statsN_ << " % saturated";
+    if(statsAcc_.inhibited)
+        std::cout << ", " << double(statsAcc_.inhibited) / statsN_ << " inhibited/pass";
+    if(statsAcc_.active)
+        std::cout << ", " << double(statsAcc_.active) / statsN_ << " active/pass";
+    if(statsAcc_.span)
+        std::cout << ", " << 100.0 * double(statsAcc_.visited) / statsAcc_.span << " % visited";
+    if(statsAcc_.cacheMisses)
+        std::cout << ", " << double(statsAcc_.cacheMisses) / statsN_ << " cache-misses/pass";
+    if(statsAcc_.tlbMisses)
+        std::cout << ", " << double(statsAcc_.tlbMisses) / statsN_ << " dTLB-misses/pass";
+
+    /* per-node synapse bandwidth, only once a second node shows up */
+    uint32_t nNodes = 0;
+    for(uint32_t k=0;k<kStatsNodes;++k) if(statsAcc_.nodeBytes[k]) nNodes = k+1;
+    if(nNodes > 1){
+        std::cout << ", GB/s by node:";
+        for(uint32_t k=0;k<nNodes;++k)
+            std::cout << " " << statsAcc_.nodeBytes[k] / sec * 1e-9;
+    }
+    std::cout << std::endl;
+
+    statsAcc_ = TraversalStats{};
+    statsN_   = 0;
+    statsT0_  = t1;
+}
+
+/* engine pipeline -------------------------------------------------------- */
+void Logger::log_pipeline(const PipelineStats& p, uint32_t nPasses)
+{
+    pipeAcc_.busy     += p.busy;
+    pipeAcc_.waitStim += p.waitStim;
+    pipeAcc_.waitLag  += p.waitLag;
+    pipeAcc_.waitOut  += p.waitOut;
+    pipeN_ += nPasses;
+    if(pipeN_ < kStatsEvery) return;
+
+    const double all = pipeAcc_.busy + pipeAcc_.waitStim + pipeAcc_.waitLag + pipeAcc_.waitOut;
+    const double pct = all > 0.0 ? 100.0 / all : 0.0;
+    std::cout << "🛠  simulator " << pipeAcc_.busy * pct << " % busy, waiting on stimulus "
+              << pipeAcc_.waitStim * pct << " %, reward lag "
+              << pipeAcc_.waitLag  * pct << " %, readout "
+              << pipeAcc_.waitOut  * pct << " %" << std::endl;
+
+    pipeAcc_ = PipelineStats{};
+    pipeN_   = 0;
+}
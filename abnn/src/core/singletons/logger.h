@@ -1,7 +1,18 @@
 #pragma once
 #include <vector>
+#include <chrono>
 #include <fstream>
 #include <string>
+#include "cpu-traversal.h"
+
+/* simulator-thread time split of the engine pipeline, seconds */
+struct PipelineStats
+{
+    double busy    {0.0};     /* running passes                         */
+    double waitStim{0.0};     /* stimulus queue empty                   */
+    double waitLag {0.0};     /* PIPE_REWARD_LAG passes ahead of readout */
+    double waitOut {0.0};     /* readout queue full                     */
+};
 
 class Logger
 {
@@ -17,6 +28,13 @@ public:
     void accumulate_loss(double loss);
     void flush();             /* prints output matlab file */
 
+    /* CPU backend throughput, printed every kStatsEvery passes;
+       s may sum nPasses passes (Brain::batch_stats)               */
+    void log_pass_stats(const TraversalStats& s, uint32_t nPasses = 1);
+
+    /* simulator utilization, printed every kStatsEvery passes */
+    void log_pipeline(const PipelineStats& p, uint32_t nPasses);
+
 private:
     int  nIn_, nOut_;
     std::ofstream mat_;
@@ -25,4 +43,14 @@ private:
     double ema_ = 0.0;
     double beta_= 0.98;            /* smoothing */
     uint64_t step_ = 0;
+
+    /* pass-stats accumulator */
+    static constexpr uint32_t kStatsEvery = 1000;
+    TraversalStats statsAcc_;
+    uint32_t       statsN_ = 0;
+    std::chrono::steady_clock::time_point statsT0_ = std::chrono::steady_clock::now();
+
+    /* pipeline accumulator */
+    PipelineStats  pipeAcc_;
+    uint32_t       pipeN_ = 0;
 };
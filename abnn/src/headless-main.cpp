@@ -0,0 +1,66 @@
+//
+//  headless-main.cpp
+//  abnn
+//
+//  Entry point for non-Apple hosts: runs the BrainEngine on the CPU
+//  backend with the same sine→cos² stimulus as ViewDelegate, until
+//  SIGINT / SIGTERM, then saves the model. With CKPT_EVERY_SEC it also
+//  checkpoints in the background while running.
+//
+#if !defined(__APPLE__)
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "brain-engine.h"
+#include "functional-dataset.h"
+#include "constants.h"
+
+static std::atomic<bool> gStop{false};
+
+static void on_signal(int){ gStop.store(true); }
+
+int main()
+{
+    std::signal(SIGINT,  on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    BrainEngine engine(NUM_INPUTS, NUM_OUTPUTS);
+
+    auto stim = std::make_shared<FunctionalDataset>(
+                    /*nInput=*/NUM_INPUTS,
+                                NUM_OUTPUTS,
+                    /*dtSec =*/ dT_SEC,
+                    /*freqHz=*/INPUT_SIN_WAVE_FREQUENCY,
+                                                    [](float x){
+                                                        return cos(x) * cos(x);
+                                                    },
+                                                    [](float x){
+                                                        return 0.5f * sin(x) + 0.5f;
+                                                    });
+    engine.set_stimulus(stim);
+    engine.start_async();
+
+    std::cout << "✅ BrainEngine loaded (CPU backend)" << std::endl;
+
+    auto lastCkpt = std::chrono::steady_clock::now();
+    while(!gStop.load()){
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if(CKPT_EVERY_SEC > 0 && std::chrono::steady_clock::now() - lastCkpt
+                                 >= std::chrono::seconds(CKPT_EVERY_SEC)){
+            engine.checkpoint();
+            lastCkpt = std::chrono::steady_clock::now();
+        }
+    }
+
+    engine.stop_async();
+    engine.save_model();
+    return 0;
+}
+
+#endif
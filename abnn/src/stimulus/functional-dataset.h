@@ -5,6 +5,7 @@
 
 #include "brain-engine.h"      // provides StimulusProvider interface
 #include <vector>
+#include <functional>
 #include "stimulus-provider.h"
 
 
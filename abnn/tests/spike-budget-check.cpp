@@ -0,0 +1,90 @@
+//
+//  spike-budget-check.cpp
+//  abnn
+//
+//  Self-check for SpikeBudget (core/cpu/spike-budget.h): workers take
+//  spikes until the budget says it is spent, while token moves sleep
+//  between their CAS and their add. Tokens in transit must never be
+//  written off: the budget is never declared spent while a move is in
+//  that window, each round grants exactly `total` spikes, and
+//  afterwards every worker sees the budget exhausted.
+//  Exit code 0 → all rounds conserved the tokens.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+static thread_local uint32_t tMoves = 0;
+static std::atomic<uint64_t> gDoneInFlight{0};
+
+/* every other move stalls inside its window, so the other workers scan
+   while those tokens are in neither place; expanded inside move(), so
+   it sees done_ – set by then, the moving tokens were written off    */
+#define SPIKE_BUDGET_MOVE_WINDOW()                                                      \
+    do{                                                                                 \
+        if(++tMoves & 1) std::this_thread::sleep_for(std::chrono::microseconds(20));    \
+        if(done_.load()) gDoneInFlight.fetch_add(1);                                    \
+    }while(0)
+
+#include "spike-budget.h"
+#include "brain-types.h"
+
+/* one pass: nW workers spend the budget the way the kernels do, polling
+   exhausted() before each take(); returns the spikes granted         */
+static uint64_t run_round(SpikeBudget& b, uint32_t total, uint32_t nW, bool& stuck)
+{
+    b.reset(total, nW);
+    std::vector<uint64_t>    granted(nW, 0);
+    std::vector<std::thread> th;
+    std::atomic<uint32_t>    ready{0};
+    for(uint32_t w=0; w<nW; ++w)
+        th.emplace_back([&, w]{
+            ready.fetch_add(1);
+            while(ready.load() < nW) std::this_thread::yield();
+            while(!b.exhausted(w))
+                if(b.take(w)) ++granted[w];
+        });
+    for(auto& t : th) t.join();
+
+    stuck = false;
+    for(uint32_t w=0; w<nW; ++w) stuck |= !b.exhausted(w) || b.take(w);
+    uint64_t sum = 0;
+    for(uint64_t g : granted) sum += g;
+    return sum;
+}
+
+int main()
+{
+    const uint32_t totals [] = { 1, 7, 64, 1000, kMaxSpikes };
+    const uint32_t workers[] = { 1, 2, 3, 8, 16 };
+    const int      kRounds   = 20;
+
+    SpikeBudget b;
+    uint64_t    rounds = 0, bad = 0;
+    for(uint32_t total : totals)
+        for(uint32_t nW : workers)
+            for(int r=0; r<kRounds; ++r){
+                bool stuck = false;
+                const uint64_t got = run_round(b, total, nW, stuck);
+                ++rounds;
+                if((got != total || stuck) && ++bad <= 10)
+                    std::printf("❌ total %u, %u workers: %llu granted%s\n", total, nW,
+                                (unsigned long long)got, stuck ? ", tokens left after done" : "");
+            }
+
+    const uint64_t inFlight = gDoneInFlight.load();
+    if(inFlight)
+        std::printf("❌ budget declared spent with a move in flight, %llu times\n",
+                    (unsigned long long)inFlight);
+    if(bad)
+        std::printf("❌ spike budget: %llu of %llu rounds lost or overdrew tokens\n",
+                    (unsigned long long)bad, (unsigned long long)rounds);
+    if(inFlight || bad) return 1;
+    std::printf("✅ spike budget: %llu rounds, every token granted exactly once\n",
+                (unsigned long long)rounds);
+    return 0;
+}